@@ -1,6 +1,11 @@
 option(BUILD_SKYRIM "Build for Skyrim" OFF)
 option(BUILD_SKYRIMVR "Build for Skyrim VR" OFF)
 option(BUILD_FALLOUT4 "Build for Fallout 4" OFF)
+option(SRD_ALLOCATION_STATS "Count heap allocations per load phase and section" OFF)
+option(SRD_TRACE "Write a Chrome trace-event timeline of each load" OFF)
+set(SRD_CONFLICT_TRACKING "" CACHE STRING "Fix conflict tracking at build time (none, counts or full), empty reads it from the INI")
+set_property(CACHE SRD_CONFLICT_TRACKING PROPERTY STRINGS "" none counts full)
+set(SRD_CONFLICT_TRACKING_MODES none counts full)  # same order as ConflictTracking
 
 if(BUILD_SKYRIM)
 	add_compile_definitions(SKYRIM)
@@ -34,6 +39,22 @@ target_compile_features(
 	cxx_std_23
 )
 
+if(SRD_ALLOCATION_STATS)
+	target_compile_definitions("${PROJECT_NAME}" PRIVATE SRD_ALLOCATION_STATS)
+endif()
+
+if(SRD_TRACE)
+	target_compile_definitions("${PROJECT_NAME}" PRIVATE SRD_TRACE)
+endif()
+
+if(SRD_CONFLICT_TRACKING)
+	list(FIND SRD_CONFLICT_TRACKING_MODES "${SRD_CONFLICT_TRACKING}" SRD_CONFLICT_TRACKING_INDEX)
+	if(SRD_CONFLICT_TRACKING_INDEX EQUAL -1)
+		message(FATAL_ERROR "SRD_CONFLICT_TRACKING must be none, counts or full")
+	endif()
+	target_compile_definitions("${PROJECT_NAME}" PRIVATE SRD_CONFLICT_TRACKING=${SRD_CONFLICT_TRACKING_INDEX})
+endif()
+
 set_property(GLOBAL PROPERTY USE_FOLDERS ON)
 
 include(AddCXXFiles)
@@ -66,6 +87,7 @@ target_precompile_headers(
 )
 
 find_path(SIMPLEINI_INCLUDE_DIRS "ConvertUTF.c")
+find_path(DETOURS_INCLUDE_DIRS "detours/detours.h")
 
 target_include_directories(
 	"${PROJECT_NAME}"
@@ -76,6 +98,8 @@ target_include_directories(
 	${CMAKE_CURRENT_SOURCE_DIR}/src
 	${RAPIDXML_INCLUDE_DIRS}
 	${MERGEMAPPER_INCLUDE_DIRS}
+	${SIMPLEINI_INCLUDE_DIRS}
+	${DETOURS_INCLUDE_DIRS}
 )
 
 set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
@@ -139,6 +163,9 @@ find_path(RAPIDXML_INCLUDE_DIRS "rapidxml/rapidxml.hpp")
 find_package(yaml-cpp CONFIG REQUIRED)
 find_package(nlohmann_json CONFIG REQUIRED)
 find_package(directxtk CONFIG REQUIRED)
+find_package(ZLIB REQUIRED)
+find_package(lz4 CONFIG REQUIRED)
+find_library(DETOURS_LIBRARY detours REQUIRED)
 
 if(BUILD_SKYRIM)
 	find_package(CommonLibSSE REQUIRED)
@@ -149,6 +176,9 @@ if(BUILD_SKYRIM)
 		PRIVATE
 		nlohmann_json::nlohmann_json
 		yaml-cpp::yaml-cpp
+		ZLIB::ZLIB
+		lz4::lz4
+		${DETOURS_LIBRARY}
 	)
 else()
 	add_subdirectory(${CommonLibPath} ${CommonLibName} EXCLUDE_FROM_ALL)
@@ -0,0 +1,58 @@
+#include "AliasTable.h"
+
+AliasTable::AliasTable(std::span<const float> a_weights) :
+	entries(a_weights.size())
+{
+	const auto size = a_weights.size();
+	if (!size)
+		return;
+
+	std::vector<double> scaled(size);
+	double total = 0.0;
+	for (std::size_t i = 0; i < size; i++) {
+		const auto weight = a_weights[i];
+		scaled[i] = std::isfinite(weight) && weight > 0.0f ? weight : 0.0;
+		total += scaled[i];
+	}
+	for (auto& weight : scaled)
+		weight = total > 0.0 ? weight * static_cast<double>(size) / total : 1.0;
+
+	std::vector<std::uint32_t> small;
+	std::vector<std::uint32_t> large;
+	for (std::uint32_t i = 0; i < size; i++)
+		(scaled[i] < 1.0 ? small : large).push_back(i);
+
+	constexpr double scale = 4294967296.0;  // 2^32
+	while (!small.empty() && !large.empty()) {
+		const auto less = small.back();
+		small.pop_back();
+		const auto more = large.back();
+
+		entries[less] = { static_cast<std::uint64_t>(scaled[less] * scale), more };
+		scaled[more] -= 1.0 - scaled[less];
+		if (scaled[more] < 1.0) {
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+
+	// Whatever is left is 1 up to rounding
+	for (const auto index : small)
+		entries[index] = { static_cast<std::uint64_t>(scale), index };
+	for (const auto index : large)
+		entries[index] = { static_cast<std::uint64_t>(scale), index };
+}
+
+double AliasTable::GetProbability(std::uint32_t a_index) const
+{
+	constexpr double scale = 4294967296.0;
+	double result = 0.0;
+	for (std::uint32_t column = 0; column < entries.size(); column++) {
+		const auto own = static_cast<double>(entries[column].threshold) / scale;
+		if (column == a_index)
+			result += own;
+		if (entries[column].alias == a_index)
+			result += 1.0 - own;
+	}
+	return result / static_cast<double>(entries.size());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Weighted sampling with Vose's alias method. Built once in O(n), a draw takes one 64-bit random number, two
+// multiplies and a compare, whatever the number of entries. Shared with the offline tools for benchmarking.
+class AliasTable
+{
+public:
+	AliasTable() = default;
+
+	// Weights that are negative, NaN or infinite count as 0, all zero weights draw uniformly
+	explicit AliasTable(std::span<const float> a_weights);
+
+	std::uint32_t Sample(std::uint64_t a_random) const
+	{
+		// High half picks the column, low half decides between the column and its alias
+		const auto column = static_cast<std::uint32_t>(((a_random >> 32) * entries.size()) >> 32);
+		const auto& entry = entries[column];
+		return (a_random & 0xFFFFFFFF) < entry.threshold ? column : entry.alias;
+	}
+
+	std::size_t GetSize() const { return entries.size(); }
+
+	// Probability of drawing a_index, for checking a table against its weights
+	double GetProbability(std::uint32_t a_index) const;
+
+	// splitmix64, a_state is per thread so a draw never synchronizes
+	static std::uint64_t NextRandom(std::uint64_t& a_state)
+	{
+		auto z = (a_state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+private:
+	struct Entry
+	{
+		std::uint64_t threshold;  // out of 2^32, 2^32 never takes the alias
+		std::uint32_t alias;
+	};
+
+	std::vector<Entry> entries;
+};
@@ -0,0 +1,133 @@
+#include "AllocationStats.h"
+
+#ifdef SRD_ALLOCATION_STATS
+
+namespace
+{
+	constexpr std::size_t sectionSlots = static_cast<std::size_t>(Schema::Section::kTotal) + 1;  // slot 0 is the phase itself
+	constexpr std::size_t categoryCount = static_cast<std::size_t>(AllocationStats::Phase::kTotal) * sectionSlots;
+
+	constexpr std::string_view phaseNames[] = { "Other", "Scan", "Parse", "Resolve", "Apply", "Conflicts" };
+	static_assert(std::size(phaseNames) == static_cast<std::size_t>(AllocationStats::Phase::kTotal));
+
+	// Plain arrays with constant initialization, operator new can run before any dynamic initializer
+	constinit std::atomic<std::uint64_t> allocations[categoryCount]{};
+	constinit std::atomic<std::uint64_t> bytes[categoryCount]{};
+	constinit thread_local std::uint8_t category = 0;
+
+	auto GetCategory(AllocationStats::Phase a_phase, std::optional<Schema::Section> a_section) -> std::size_t
+	{
+		const auto slot = a_section ? static_cast<std::size_t>(*a_section) + 1 : 0;
+		return static_cast<std::size_t>(a_phase) * sectionSlots + slot;
+	}
+
+	void Record(std::size_t a_size)
+	{
+		allocations[category].fetch_add(1, std::memory_order_relaxed);
+		bytes[category].fetch_add(a_size, std::memory_order_relaxed);
+	}
+
+	auto Allocate(std::size_t a_size) -> void*
+	{
+		Record(a_size);
+		if (auto ptr = std::malloc(a_size ? a_size : 1))
+			return ptr;
+		throw std::bad_alloc();
+	}
+
+	auto AllocateAligned(std::size_t a_size, std::align_val_t a_alignment) -> void*
+	{
+		Record(a_size);
+		const auto alignment = static_cast<std::size_t>(a_alignment);
+#ifdef _WIN32
+		if (auto ptr = _aligned_malloc(a_size ? a_size : 1, alignment))
+			return ptr;
+#else
+		if (auto ptr = std::aligned_alloc(alignment, (a_size + alignment - 1) / alignment * alignment))
+			return ptr;
+#endif
+		throw std::bad_alloc();
+	}
+
+	void FreeAligned(void* a_ptr) noexcept
+	{
+#ifdef _WIN32
+		_aligned_free(a_ptr);
+#else
+		std::free(a_ptr);
+#endif
+	}
+}
+
+void* operator new(std::size_t a_size) { return Allocate(a_size); }
+void* operator new[](std::size_t a_size) { return Allocate(a_size); }
+void* operator new(std::size_t a_size, std::align_val_t a_alignment) { return AllocateAligned(a_size, a_alignment); }
+void* operator new[](std::size_t a_size, std::align_val_t a_alignment) { return AllocateAligned(a_size, a_alignment); }
+void operator delete(void* a_ptr) noexcept { std::free(a_ptr); }
+void operator delete[](void* a_ptr) noexcept { std::free(a_ptr); }
+void operator delete(void* a_ptr, std::size_t) noexcept { std::free(a_ptr); }
+void operator delete[](void* a_ptr, std::size_t) noexcept { std::free(a_ptr); }
+void operator delete(void* a_ptr, std::align_val_t) noexcept { FreeAligned(a_ptr); }
+void operator delete[](void* a_ptr, std::align_val_t) noexcept { FreeAligned(a_ptr); }
+void operator delete(void* a_ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(a_ptr); }
+void operator delete[](void* a_ptr, std::size_t, std::align_val_t) noexcept { FreeAligned(a_ptr); }
+
+AllocationStats::Scope::Scope(Phase a_phase, std::optional<Schema::Section> a_section) :
+	previous(category)
+{
+	category = static_cast<std::uint8_t>(GetCategory(a_phase, a_section));
+}
+
+AllocationStats::Scope::~Scope()
+{
+	category = previous;
+}
+
+auto AllocationStats::Get(Phase a_phase, std::optional<Schema::Section> a_section) -> Count
+{
+	const auto index = GetCategory(a_phase, a_section);
+	return { allocations[index].load(std::memory_order_relaxed), bytes[index].load(std::memory_order_relaxed) };
+}
+
+void AllocationStats::Reset()
+{
+	for (std::size_t i = 0; i < categoryCount; i++) {
+		allocations[i].store(0, std::memory_order_relaxed);
+		bytes[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void AllocationStats::Report()
+{
+	logger::info("\nHeap allocations by phase:");
+	for (std::size_t p = 0; p < static_cast<std::size_t>(Phase::kTotal); p++) {
+		const auto phase = static_cast<Phase>(p);
+		const auto [count, size] = Get(phase);
+		if (count)
+			logger::info("    {}: {} allocations, {} bytes", phaseNames[p], count, size);
+
+		for (std::size_t s = 0; s < static_cast<std::size_t>(Schema::Section::kTotal); s++) {
+			const auto section = static_cast<Schema::Section>(s);
+			const auto [sectionCount, sectionSize] = Get(phase, section);
+			if (sectionCount)
+				logger::info("    {} {}: {} allocations, {} bytes", phaseNames[p], Schema::GetSection(section).name, sectionCount, sectionSize);
+		}
+	}
+}
+
+#else
+
+auto AllocationStats::Get(Phase, std::optional<Schema::Section>) -> Count
+{
+	return {};
+}
+
+void AllocationStats::Reset()
+{
+}
+
+void AllocationStats::Report()
+{
+}
+
+#endif
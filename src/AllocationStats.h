@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ConfigSchema.h"
+
+// Counts heap allocations per phase of LoadConfigs and per section while resolving and applying records.
+// Only active in builds configured with SRD_ALLOCATION_STATS, otherwise scopes compile to nothing.
+namespace AllocationStats
+{
+	enum class Phase : std::uint8_t
+	{
+		kNone,
+		kScan,
+		kParse,
+		kResolve,
+		kApply,
+		kConflicts,
+
+		kTotal
+	};
+
+#ifdef SRD_ALLOCATION_STATS
+	inline constexpr bool enabled = true;
+#else
+	inline constexpr bool enabled = false;
+#endif
+
+	// Attributes allocations of the calling thread to a phase, and optionally a section, until destroyed
+	class Scope
+	{
+	public:
+		explicit Scope(Phase a_phase, std::optional<Schema::Section> a_section = std::nullopt);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		std::uint8_t previous;
+	};
+
+	struct Count
+	{
+		std::uint64_t allocations;
+		std::uint64_t bytes;
+	};
+
+	auto Get(Phase a_phase, std::optional<Schema::Section> a_section = std::nullopt) -> Count;
+	void Reset();
+
+	// Logs the counts of every phase and section that allocated
+	void Report();
+}
+
+#ifndef SRD_ALLOCATION_STATS
+inline AllocationStats::Scope::Scope(Phase, std::optional<Schema::Section>) :
+	previous(0)
+{
+}
+
+inline AllocationStats::Scope::~Scope() = default;
+#endif
@@ -0,0 +1,261 @@
+#include "Archive.h"
+
+#include <lz4frame.h>
+#include <zlib.h>
+
+namespace
+{
+	constexpr std::uint32_t magic = 0x00415342;  // "BSA\0"
+	constexpr std::uint32_t versionLE = 104;
+	constexpr std::uint32_t versionSE = 105;
+
+	constexpr std::uint32_t sizeMask = 0x3FFFFFFF;
+	constexpr std::uint32_t compressionToggle = 0x40000000;
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t offset;
+		std::uint32_t flags;
+		std::uint32_t folderCount;
+		std::uint32_t fileCount;
+		std::uint32_t folderNamesLength;
+		std::uint32_t fileNamesLength;
+		std::uint32_t fileFlags;
+	};
+	static_assert(sizeof(Header) == 36);
+
+	// Bounds-checked reads from the mapping, every read moves the cursor
+	class Reader
+	{
+	public:
+		explicit Reader(std::span<const std::byte> a_data, std::size_t a_offset = 0) :
+			data(a_data), offset(a_offset) {}
+
+		template <class T>
+		bool Read(T& a_value)
+		{
+			if (offset > data.size() || data.size() - offset < sizeof(T))
+				return false;
+			std::memcpy(&a_value, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(std::size_t a_length, std::string_view& a_value)
+		{
+			if (offset > data.size() || data.size() - offset < a_length)
+				return false;
+			a_value = { reinterpret_cast<const char*>(data.data() + offset), a_length };
+			offset += a_length;
+			return true;
+		}
+
+		bool Skip(std::size_t a_length)
+		{
+			if (offset > data.size() || data.size() - offset < a_length)
+				return false;
+			offset += a_length;
+			return true;
+		}
+
+		std::size_t GetOffset() const { return offset; }
+
+	private:
+		std::span<const std::byte> data;
+		std::size_t offset;
+	};
+
+	auto TrimNull(std::string_view a_string) -> std::string_view
+	{
+		if (const auto end = a_string.find('\0'); end != std::string_view::npos)
+			return a_string.substr(0, end);
+		return a_string;
+	}
+
+	bool DecompressLZ4(std::span<const std::byte> a_source, std::string& a_data)
+	{
+		LZ4F_dctx* context = nullptr;
+		if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)))
+			return false;
+
+		std::size_t written = 0;
+		std::size_t read = 0;
+		std::size_t result = 1;
+		while (result != 0 && read < a_source.size() && written < a_data.size()) {
+			std::size_t dstSize = a_data.size() - written;
+			std::size_t srcSize = a_source.size() - read;
+			result = LZ4F_decompress(context, a_data.data() + written, &dstSize, a_source.data() + read, &srcSize, nullptr);
+			if (LZ4F_isError(result))
+				break;
+			written += dstSize;
+			read += srcSize;
+		}
+		LZ4F_freeDecompressionContext(context);
+		return !LZ4F_isError(result) && written == a_data.size();
+	}
+}
+
+bool Archive::Open(const std::filesystem::path& a_path, std::string& a_error)
+{
+	path = a_path;
+
+	if (!file.Open(a_path)) {
+		a_error = "failed to map file";
+		return false;
+	}
+
+	Header header;
+	Reader reader(file.GetData());
+	if (!reader.Read(header) || header.magic != magic) {
+		a_error = "not a BSA archive";
+		return false;
+	}
+	if (header.version != versionLE && header.version != versionSE) {
+		a_error = "unsupported BSA version " + std::to_string(header.version);
+		return false;
+	}
+
+	version = header.version;
+	flags = header.flags;
+	return true;
+}
+
+std::span<const Archive::Entry> Archive::GetEntries() const
+{
+	std::call_once(indexed, [this] { BuildIndex(); });
+	return entries;
+}
+
+void Archive::BuildIndex() const
+{
+	const auto data = file.GetData();
+
+	Header header;
+	Reader reader(data);
+	reader.Read(header);
+
+	if (!(flags & kDirectoryNames) || !(flags & kFileNames)) {
+		indexError = "archive has no file names";
+		return;
+	}
+
+	struct Folder
+	{
+		std::uint32_t count;
+	};
+
+	if (header.offset < sizeof(Header) || !reader.Skip(header.offset - sizeof(Header))) {
+		indexError = "archive header is damaged";
+		return;
+	}
+	// Counts are checked against the size of their records before anything is allocated for them
+	const std::size_t folderRecordSize = version == versionSE ? 24 : 16;
+	if (header.folderCount > data.size() / folderRecordSize || header.fileCount > data.size() / 16) {
+		indexError = "archive header is damaged";
+		return;
+	}
+
+	std::vector<Folder> folders(header.folderCount);
+	for (auto& folder : folders) {
+		std::uint64_t hash;
+		bool valid = reader.Read(hash) && reader.Read(folder.count);
+		// 105 widens the offset to 64 bits and pads the count
+		valid &= version == versionSE ? reader.Skip(4 + 8) : reader.Skip(4);
+		if (!valid) {
+			indexError = "folder records are damaged";
+			return;
+		}
+	}
+
+	// Names follow the last file record block, in file record order
+	std::vector<Entry> result;
+	result.reserve(header.fileCount);
+	for (const auto& folder : folders) {
+		std::uint8_t length;
+		std::string_view name;
+		if (!reader.Read(length) || !reader.ReadString(length, name)) {
+			indexError = "file records are damaged";
+			return;
+		}
+
+		for (std::uint32_t i = 0; i < folder.count; i++) {
+			std::uint64_t hash;
+			std::uint32_t size;
+			std::uint32_t offset;
+			if (!reader.Read(hash) || !reader.Read(size) || !reader.Read(offset)) {
+				indexError = "file records are damaged";
+				return;
+			}
+			const bool compressed = static_cast<bool>(flags & kCompressed) != static_cast<bool>(size & compressionToggle);
+			result.emplace_back(TrimNull(name), std::string_view{}, offset, size & sizeMask, compressed);
+		}
+	}
+
+	std::string_view names;
+	if (!reader.ReadString(header.fileNamesLength, names)) {
+		indexError = "file names are damaged";
+		return;
+	}
+	for (auto& entry : result) {
+		const auto end = names.find('\0');
+		if (end == std::string_view::npos) {
+			indexError = "file names are damaged";
+			return;
+		}
+		entry.name = names.substr(0, end);
+		names.remove_prefix(end + 1);
+	}
+
+	entries = std::move(result);
+}
+
+bool Archive::Read(const Entry& a_entry, std::string& a_data, std::string& a_error) const
+{
+	const auto data = file.GetData();
+	if (a_entry.offset > data.size() || a_entry.size > data.size() - a_entry.offset) {
+		a_error = "entry is outside the archive";
+		return false;
+	}
+
+	Reader reader(data.first(a_entry.offset + a_entry.size), a_entry.offset);
+
+	// Archives built with embedded names repeat the full path in front of the data
+	if (flags & kEmbeddedNames) {
+		std::uint8_t length;
+		if (!reader.Read(length) || !reader.Skip(length)) {
+			a_error = "entry is damaged";
+			return false;
+		}
+	}
+
+	if (!a_entry.compressed) {
+		std::string_view content;
+		reader.ReadString(a_entry.offset + a_entry.size - reader.GetOffset(), content);
+		a_data.assign(content);
+		return true;
+	}
+
+	std::uint32_t originalSize;
+	if (!reader.Read(originalSize)) {
+		a_error = "entry is damaged";
+		return false;
+	}
+
+	const auto source = data.subspan(reader.GetOffset(), a_entry.offset + a_entry.size - reader.GetOffset());
+	a_data.resize(originalSize);
+
+	bool valid;
+	if (version == versionSE) {
+		valid = DecompressLZ4(source, a_data);
+	} else {
+		uLongf size = originalSize;
+		valid = uncompress(reinterpret_cast<Bytef*>(a_data.data()), &size, reinterpret_cast<const Bytef*>(source.data()), static_cast<uLong>(source.size())) == Z_OK && size == originalSize;
+	}
+	if (!valid) {
+		a_error = "failed to decompress entry";
+		return false;
+	}
+	return true;
+}
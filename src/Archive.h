@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MappedFile.h"
+
+// Reads files out of a Skyrim BSA, version 104 (LE, zlib) and 105 (SE, LZ4). Open only maps the archive, the folder
+// and file records are indexed on the first call to GetEntries. Entries are read straight from the mapping.
+class Archive
+{
+public:
+	struct Entry
+	{
+		std::string_view folder;  // as stored, lowercase with backslashes, empty or "." for the archive root
+		std::string_view name;
+		std::uint32_t offset;
+		std::uint32_t size;
+		bool compressed;
+	};
+
+	bool Open(const std::filesystem::path& a_path, std::string& a_error);
+
+	const std::filesystem::path& GetPath() const { return path; }
+
+	// Builds the index on first use, thread-safe. Empty when the records are damaged, GetError() tells why.
+	std::span<const Entry> GetEntries() const;
+	const std::string& GetError() const { return indexError; }
+
+	// Copies the entry into a_data, decompressing it if needed. Safe to call from several threads.
+	bool Read(const Entry& a_entry, std::string& a_data, std::string& a_error) const;
+
+private:
+	enum Flag : std::uint32_t
+	{
+		kDirectoryNames = 0x1,
+		kFileNames = 0x2,
+		kCompressed = 0x4,
+		kEmbeddedNames = 0x100
+	};
+
+	void BuildIndex() const;
+
+	MappedFile file;
+	std::filesystem::path path;
+	std::uint32_t version = 0;
+	std::uint32_t flags = 0;
+
+	mutable std::once_flag indexed;
+	mutable std::vector<Entry> entries;
+	mutable std::string indexError;
+};
@@ -0,0 +1,175 @@
+#include "AsyncLogSink.h"
+
+#include <spdlog/pattern_formatter.h>
+
+AsyncLogSink::AsyncLogSink(const std::filesystem::path& a_path, std::size_t a_capacity) :
+	mask(std::bit_ceil(std::max<std::size_t>(a_capacity, 2)) - 1),
+	formatter(std::make_unique<spdlog::pattern_formatter>())
+{
+	slots = std::make_unique<Slot[]>(mask + 1);
+	for (std::uint64_t i = 0; i <= mask; i++)
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+
+#ifdef _WIN32
+	file = _wfopen(a_path.c_str(), L"wb");
+#else
+	file = std::fopen(a_path.c_str(), "wb");
+#endif
+	if (!file)
+		throw spdlog::spdlog_ex("Failed opening file " + a_path.string() + " for writing", errno);
+
+	writer = std::jthread([this](std::stop_token a_stop) { Run(a_stop); });
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+	writer.request_stop();
+	if (writer.joinable())
+		writer.join();
+	Drain();
+	std::fclose(file);
+}
+
+void AsyncLogSink::log(const spdlog::details::log_msg& a_msg)
+{
+	// pattern_formatter caches state while formatting, each thread formats with its own copy
+	thread_local struct
+	{
+		const AsyncLogSink* owner = nullptr;
+		std::uint64_t version = 0;
+		std::unique_ptr<spdlog::formatter> formatter;
+	} local;
+
+	const auto version = formatterVersion.load(std::memory_order_acquire);
+	if (local.owner != this || local.version != version || !local.formatter) {
+		std::scoped_lock guard(formatterLock);
+		local.owner = this;
+		local.version = version;
+		local.formatter = formatter->clone();
+	}
+
+	spdlog::memory_buf_t buffer;
+	local.formatter->format(a_msg, buffer);
+	std::string text(buffer.data(), buffer.size());
+
+	// A full ring means the writer is behind, wait for it rather than dropping lines
+	while (!TryPush(text)) {
+		wake.notify_all();
+		std::this_thread::yield();
+	}
+
+	if (sleeping.load()) {
+		std::scoped_lock guard(lock);
+		wake.notify_all();
+	}
+}
+
+void AsyncLogSink::flush()
+{
+	const auto target = enqueuePos.load();
+
+	std::unique_lock guard(lock);
+	wake.notify_all();
+	wake.wait(guard, [&] { return written.load() >= target; });
+}
+
+void AsyncLogSink::set_pattern(const std::string& a_pattern)
+{
+	set_formatter(std::make_unique<spdlog::pattern_formatter>(a_pattern));
+}
+
+void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> a_formatter)
+{
+	std::scoped_lock guard(formatterLock);
+	formatter = std::move(a_formatter);
+	formatterVersion.fetch_add(1, std::memory_order_release);
+}
+
+void AsyncLogSink::FlushFromCrash() noexcept
+{
+	// The writer keeps running while the crashing thread is in here, its batch ends within a few writes
+	for (int i = 0; i < 2000; i++) {
+		if (!draining.test_and_set(std::memory_order_acquire)) {
+			WriteQueued();
+			draining.clear(std::memory_order_release);
+			return;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+bool AsyncLogSink::TryPush(std::string& a_text)
+{
+	auto pos = enqueuePos.load(std::memory_order_relaxed);
+	while (true) {
+		auto& slot = slots[pos & mask];
+		const auto sequence = slot.sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<std::int64_t>(sequence - pos);
+		if (diff == 0) {
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.text = std::move(a_text);
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool AsyncLogSink::TryPop(std::string& a_text)
+{
+	const auto pos = dequeuePos.load(std::memory_order_relaxed);
+	auto& slot = slots[pos & mask];
+	if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+		return false;
+
+	a_text = std::move(slot.text);
+	slot.sequence.store(pos + mask + 1, std::memory_order_release);
+	dequeuePos.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+std::size_t AsyncLogSink::Drain()
+{
+	if (draining.test_and_set(std::memory_order_acquire))
+		return 0;
+
+	const auto count = WriteQueued();
+	draining.clear(std::memory_order_release);
+
+	if (count) {
+		std::scoped_lock guard(lock);
+		written.fetch_add(count);
+		wake.notify_all();
+	}
+	return count;
+}
+
+std::size_t AsyncLogSink::WriteQueued()
+{
+	std::size_t count = 0;
+	std::string text;
+	while (TryPop(text)) {
+		std::fwrite(text.data(), 1, text.size(), file);
+		count++;
+	}
+	if (count)
+		std::fflush(file);
+	return count;
+}
+
+void AsyncLogSink::Run(std::stop_token a_stop)
+{
+	while (!a_stop.stop_requested()) {
+		if (Drain())
+			continue;
+
+		std::unique_lock guard(lock);
+		sleeping.store(true);
+		wake.wait_for(guard, a_stop, std::chrono::milliseconds(100), [&] { return enqueuePos.load() != dequeuePos.load(std::memory_order_acquire); });
+		sleeping.store(false);
+	}
+}
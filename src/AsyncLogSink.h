@@ -0,0 +1,57 @@
+#pragma once
+
+#include <spdlog/sinks/sink.h>
+
+// File sink that hands formatted lines to a background writer through a bounded lock-free ring, so logging on the
+// load path never waits on disk I/O. flush() is synchronous, the logger flushes on errors so they always reach the file.
+class AsyncLogSink final : public spdlog::sinks::sink
+{
+public:
+	AsyncLogSink(const std::filesystem::path& a_path, std::size_t a_capacity = 8192);
+	~AsyncLogSink() override;
+
+	AsyncLogSink(const AsyncLogSink&) = delete;
+	AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+	void log(const spdlog::details::log_msg& a_msg) override;
+	void flush() override;
+	void set_pattern(const std::string& a_pattern) override;
+	void set_formatter(std::unique_ptr<spdlog::formatter> a_formatter) override;
+
+	// Writes what is still queued from the calling thread, for crash handlers where the writer may never run again.
+	// Waits a moment for the writer to finish a batch it already started, it gives up rather than racing it.
+	void FlushFromCrash() noexcept;
+
+private:
+	struct Slot
+	{
+		std::atomic<std::uint64_t> sequence;
+		std::string text;
+	};
+
+	bool TryPush(std::string& a_text);
+	bool TryPop(std::string& a_text);
+	std::size_t Drain();
+	std::size_t WriteQueued();  // with draining held
+	void Run(std::stop_token a_stop);
+
+	std::unique_ptr<Slot[]> slots;
+	const std::uint64_t mask;
+	alignas(64) std::atomic<std::uint64_t> enqueuePos{ 0 };
+	alignas(64) std::atomic<std::uint64_t> dequeuePos{ 0 };  // only advanced by whoever holds draining
+	std::atomic_flag draining;
+
+	std::FILE* file = nullptr;
+
+	// Producers only take the lock to wake a sleeping writer, waiting for a flush is the only other user
+	std::mutex lock;
+	std::condition_variable_any wake;
+	std::atomic<bool> sleeping{ false };
+	std::atomic<std::uint64_t> written{ 0 };
+
+	std::mutex formatterLock;
+	std::unique_ptr<spdlog::formatter> formatter;
+	std::atomic<std::uint64_t> formatterVersion{ 0 };
+
+	std::jthread writer;
+};
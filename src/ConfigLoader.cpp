@@ -0,0 +1,427 @@
+#include "ConfigLoader.h"
+
+#include "Requirements.h"
+#include "Trace.h"
+#include "tojson.hpp"
+
+namespace
+{
+	auto ToLower(std::string_view a_string) -> std::string
+	{
+		std::string result(a_string);
+		std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+		return result;
+	}
+
+	bool StartsWithNoCase(std::string_view a_string, std::string_view a_prefix)
+	{
+		return a_string.size() >= a_prefix.size() && ToLower(a_string.substr(0, a_prefix.size())) == ToLower(a_prefix);
+	}
+
+	// Archive tools store names in lowercase, so the _SRD suffix is matched without case
+	bool IsArchivedConfig(std::string_view a_name)
+	{
+		auto name = ToLower(a_name);
+		const auto suffix = ToLower(Schema::configSuffix);
+		const auto position = name.rfind(suffix);
+		if (position == std::string::npos)
+			return false;
+		name.replace(position, suffix.size(), Schema::configSuffix);
+		return Schema::IsConfigFile(name);
+	}
+}
+
+ConfigLoader::ConfigLoader(IsLoadedFunc a_isLoaded, LogFunc a_log) :
+	isLoaded(std::move(a_isLoaded)),
+	log(std::move(a_log))
+{
+}
+
+std::pair<std::set<std::string>, std::set<std::string>>
+ConfigLoader::ScanConfigDirectory(const std::filesystem::path& a_folder, std::span<const std::filesystem::path> a_archives)
+{
+	SRD_TRACE_SCOPE("Scan", a_folder.string());
+
+	std::set<std::string> generalConfigs;
+	std::set<std::string> pluginConfigs;
+
+	Log(Level::kInfo, "\nScanning " + a_folder.string() + " for configs ending with _SRD.json/.jsonc/.yaml/.srdb...");
+
+	std::set<std::string> looseNames;
+	std::set<std::string> knownNames;  // lowercase, every loose and bundled config
+	std::set<std::filesystem::path> bundlePaths;
+
+	for (const auto& entry : std::filesystem::directory_iterator(a_folder)) {
+		if (!entry.exists() || entry.path().empty()) {
+			continue;
+		}
+
+		if (Schema::IsBundleFile(entry.path())) {
+			bundlePaths.insert(entry.path());
+			continue;
+		}
+
+		if (!Schema::IsConfigFile(entry.path())) {
+			continue;
+		}
+
+		const auto path = entry.path().string();
+		looseNames.insert(entry.path().filename().string());
+		knownNames.insert(ToLower(entry.path().filename().string()));
+
+		// Old logic: plugin configs contain ".es"
+		if (Schema::IsPluginConfig(entry.path())) {
+			Log(Level::kDebug, "Found plugin-specific config: " + path);
+			pluginConfigs.insert(path);
+		} else {
+			Log(Level::kDebug, "Found general config: " + path);
+			generalConfigs.insert(path);
+		}
+	}
+
+	// Bundled configs are listed as <bundle>\<config name>, loose configs of the same name override them
+	for (const auto& bundlePath : bundlePaths) {
+		SRD_TRACE_SCOPE("Open bundle", bundlePath.filename().string());
+		auto bundle = std::make_unique<Pack::Bundle>();
+		std::string error;
+		if (!bundle->Open(bundlePath, error)) {
+			Log(Level::kError, "Failed to load bundle " + bundlePath.string() + "\n" + error);
+			continue;
+		}
+
+		const auto& view = bundle->GetView();
+		Log(Level::kInfo, "Found bundle " + bundlePath.string() + " with " + std::to_string(view.configs.size()) + " configs");
+
+		for (std::uint32_t i = 0; i < view.configs.size(); i++) {
+			const std::string name{ view.GetString(view.configs[i].name) };
+			if (looseNames.contains(name)) {
+				Log(Level::kDebug, "Loose config " + name + " overrides the one in " + bundlePath.filename().string());
+				continue;
+			}
+
+			const auto path = (bundlePath / name).string();
+			if (!bundleConfigs.try_emplace(path, bundle.get(), i).second)
+				continue;
+			knownNames.insert(ToLower(name));
+
+			if (Schema::IsPluginConfig(name)) {
+				Log(Level::kDebug, "Found bundled plugin-specific config: " + path);
+				pluginConfigs.insert(path);
+			} else {
+				Log(Level::kDebug, "Found bundled general config: " + path);
+				generalConfigs.insert(path);
+			}
+		}
+
+		bundles.push_back(std::move(bundle));
+	}
+
+	ScanArchives(a_archives, knownNames, generalConfigs, pluginConfigs);
+
+	return { generalConfigs, pluginConfigs };
+}
+
+void ConfigLoader::ScanArchives(std::span<const std::filesystem::path> a_archives, std::set<std::string>& a_knownNames, std::set<std::string>& a_generalConfigs, std::set<std::string>& a_pluginConfigs)
+{
+	// Walked from the last archive, so the first one to claim a name is the one the game would use
+	for (const auto& archivePath : a_archives | std::views::reverse) {
+		SRD_TRACE_SCOPE("Index archive", archivePath.filename().string());
+
+		auto archive = std::make_unique<Archive>();
+		std::string error;
+		if (!archive->Open(archivePath, error)) {
+			Log(Level::kWarning, "Failed to open archive " + archivePath.string() + ", " + error);
+			continue;
+		}
+
+		std::size_t found = 0;
+		for (const auto& entry : archive->GetEntries()) {
+			// Only the archive root, the same place loose configs are searched
+			if ((!entry.folder.empty() && entry.folder != ".") || !IsArchivedConfig(entry.name))
+				continue;
+
+			const std::string name(entry.name);
+			if (!a_knownNames.insert(ToLower(name)).second) {
+				Log(Level::kDebug, "Config " + name + " in " + archivePath.filename().string() + " is overridden");
+				continue;
+			}
+
+			const auto path = (archivePath / name).string();
+			archiveConfigs.try_emplace(path, archive.get(), &entry);
+			found++;
+
+			if (Schema::IsPluginConfig(name)) {
+				Log(Level::kDebug, "Found archived plugin-specific config: " + path);
+				a_pluginConfigs.insert(path);
+			} else {
+				Log(Level::kDebug, "Found archived general config: " + path);
+				a_generalConfigs.insert(path);
+			}
+		}
+
+		if (!archive->GetError().empty())
+			Log(Level::kWarning, "Failed to index archive " + archivePath.string() + ", " + archive->GetError());
+		if (found) {
+			Log(Level::kInfo, "Found archive " + archivePath.string() + " with " + std::to_string(found) + " configs");
+			archives.push_back(std::move(archive));
+		}
+	}
+}
+
+void ConfigLoader::ReadArchivedConfigs(std::span<const std::string* const> a_configs, WorkerPool& a_pool)
+{
+	std::vector<std::pair<const std::string*, std::pair<const Archive*, const Archive::Entry*>>> jobs;
+	for (const auto config : a_configs) {
+		if (const auto it = archiveConfigs.find(*config); it != archiveConfigs.end() && !archiveTexts.contains(*config))
+			jobs.emplace_back(config, it->second);
+	}
+	if (jobs.empty())
+		return;
+
+	SRD_TRACE_SCOPE("Read archives");
+
+	std::vector<std::string> texts(jobs.size());
+	std::vector<std::string> errors(jobs.size());
+	a_pool.Run(jobs.size(), [&](std::size_t a_index) {
+		SRD_TRACE_SCOPE("Read archived config", std::string(jobs[a_index].second.second->name));
+		const auto& [archive, entry] = jobs[a_index].second;
+		if (!archive->Read(*entry, texts[a_index], errors[a_index]) && errors[a_index].empty())
+			errors[a_index] = "failed to read entry";
+	});
+
+	for (std::size_t i = 0; i < jobs.size(); i++) {
+		if (errors[i].empty())
+			archiveTexts.emplace(*jobs[i].first, std::move(texts[i]));
+		else
+			Log(Level::kError, "Failed to read " + *jobs[i].first + "\n" + errors[i]);
+	}
+}
+
+std::map<std::string, std::set<std::string>>
+ConfigLoader::MatchPluginConfigs(const std::set<std::string>& a_pluginConfigs, std::span<const std::string> a_plugins)
+{
+	std::map<std::string, std::set<std::string>> result;
+
+	Log(Level::kInfo, "Matching plugin-specific configs to loaded plugins...");
+	for (const auto& pluginName : a_plugins) {
+		if (!isLoaded(pluginName)) {
+			Log(Level::kWarning, "Plugin " + pluginName + " is not loaded, skipping configs");
+			continue;
+		}
+
+		std::set<std::string> matched;
+
+		for (const auto& configPath : a_pluginConfigs) {
+			const auto configName = std::filesystem::path(configPath).filename().string();
+
+			// Old logic: config filename starts with plugin name. Archived names are usually lowercase.
+			if (StartsWithNoCase(configName, pluginName)) {
+				Log(Level::kDebug, "Adding config " + configName + " for plugin " + pluginName);
+				matched.insert(configPath);
+			}
+		}
+
+		if (!matched.empty()) {
+			result.emplace(pluginName, std::move(matched));
+		}
+	}
+
+	return result;
+}
+
+void ConfigLoader::ParseAllConfigs(
+	const std::map<std::string, std::set<std::string>>& a_pluginMap,
+	const std::set<std::string>& a_generalConfigs)
+{
+	Log(Level::kInfo, "\nParsing configs...");
+
+	// Plugin configs in load order, then general configs. A config two plugins match keeps its first place.
+	std::vector<const std::string*> paths;
+	std::unordered_set<std::string_view> listed;
+	const auto add = [&](const std::set<std::string>& a_configs) {
+		for (const auto& config : a_configs) {
+			if (listed.insert(config).second)
+				paths.push_back(&config);
+		}
+	};
+	for (const auto& [plugin, pluginConfigs] : a_pluginMap) {
+		Log(Level::kInfo, "Parsing " + std::to_string(pluginConfigs.size()) + " configs for plugin " + plugin);
+		add(pluginConfigs);
+	}
+	if (!a_generalConfigs.empty()) {
+		Log(Level::kInfo, "Parsing " + std::to_string(a_generalConfigs.size()) + " general configs");
+		add(a_generalConfigs);
+	}
+
+	WorkerPool pool;
+	ParseConfigs(paths, pool);
+
+	textView = textPack.GetView();
+}
+
+void ConfigLoader::ParseConfigs(std::span<const std::string* const> a_configs, WorkerPool& a_pool)
+{
+	// Read, parsed and merged in order one batch at a time, so at most a batch of archived texts and parsed documents
+	// is alive at once. Batches span plugins, so many plugins with a config or two each still fill the pool.
+	const auto batchSize = 4 * static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency()));
+
+	for (std::size_t begin = 0; begin < a_configs.size(); begin += batchSize) {
+		const auto batch = a_configs.subspan(begin, std::min(batchSize, a_configs.size() - begin));
+		ReadArchivedConfigs(batch, a_pool);
+
+		std::vector<FileContext> contexts(batch.size());
+		for (std::size_t i = 0; i < contexts.size(); i++)
+			contexts[i].path = batch[i];
+
+		a_pool.Run(contexts.size(), [&](std::size_t a_index) { ParseConfig(contexts[a_index]); });
+		for (auto& ctx : contexts)
+			MergeConfig(ctx);
+	}
+}
+
+void ConfigLoader::ParseConfig(FileContext& a_ctx) const
+{
+	using clock = std::chrono::steady_clock;
+
+	const std::filesystem::path path(*a_ctx.path);
+	a_ctx.filename = path.filename().string();
+	const std::string extension = path.extension().string();
+
+	SRD_TRACE_SCOPE("Config", a_ctx.filename);
+	a_ctx.Log(Level::kDebug, "Parsing " + a_ctx.filename);
+
+	// Bundled configs are already compiled, only their requirements are left to check
+	if (const auto it = bundleConfigs.find(*a_ctx.path); it != bundleConfigs.end()) {
+		SRD_TRACE_SCOPE("Requirements");
+		const auto& [bundle, index] = it->second;
+		const auto& view = bundle->GetView();
+		const auto missing = Requirements::GetMissing(view.GetRequirements(view.configs[index]), isLoaded);
+		for (const auto& requirement : missing)
+			a_ctx.Log(Level::kDebug, "	Missing requirement " + requirement);
+		if (missing.empty()) {
+			a_ctx.bundle = &view;
+			a_ctx.index = index;
+		}
+		return;
+	}
+
+	try {
+		std::string text;
+		if (const auto archived = archiveConfigs.find(*a_ctx.path); archived != archiveConfigs.end()) {
+			// Every worker moves out a different text, the map itself is only changed once the batch is merged
+			const auto it = archiveTexts.find(*a_ctx.path);
+			if (it == archiveTexts.end())
+				return;  // already reported by ReadArchivedConfigs
+			text = std::move(it->second);
+		} else {
+			std::ifstream file(*a_ctx.path, std::ios::binary);
+
+			if (!file.good()) {
+				a_ctx.Log(Level::kError, "Failed to parse " + a_ctx.filename + "\nBad file stream");
+				return;
+			}
+
+			text.resize(std::filesystem::file_size(path));
+			SRD_TRACE_SCOPE("Read");
+			file.read(text.data(), text.size());
+		}
+
+		const bool yaml = extension == ".yaml";
+
+		// Requirements pre-filter, skips the full parse of configs for mods that aren't loaded
+		auto begin = clock::now();
+		bool skip = false;
+		{
+			SRD_TRACE_SCOPE("Requirements");
+			if (const auto requirements = Requirements::Peek(text, yaml)) {
+				const auto missing = Requirements::GetMissing(*requirements, isLoaded);
+				for (const auto& requirement : missing)
+					a_ctx.Log(Level::kDebug, "	Missing requirement " + requirement);
+				skip = !missing.empty();
+			}
+		}
+		a_ctx.stats.prefilterTime += clock::now() - begin;
+
+		if (skip) {
+			a_ctx.stats.skippedConfigs++;
+			a_ctx.stats.skippedBytes += text.size();
+			return;
+		}
+
+		begin = clock::now();
+		nlohmann::json data;
+
+		// YAML → JSON conversion
+		if (yaml) {
+			try {
+				SRD_TRACE_SCOPE("Convert YAML");
+				a_ctx.Log(Level::kDebug, "Converting " + a_ctx.filename + " to JSON object");
+				data = tojson::yaml2json(text);
+			} catch (const std::exception& exc) {
+				a_ctx.Log(Level::kError, "Failed to convert " + a_ctx.filename + " to JSON object\n" + exc.what());
+				return;
+			}
+		}
+		// JSON / JSONC
+		else {
+			try {
+				SRD_TRACE_SCOPE("Parse JSON");
+				data = nlohmann::json::parse(text, nullptr, true, true);
+			} catch (const std::exception& exc) {
+				a_ctx.Log(Level::kError, "Failed to parse " + a_ctx.filename + "\n" + exc.what());
+				return;
+			}
+		}
+		a_ctx.stats.parseTime += clock::now() - begin;
+		a_ctx.stats.parsedBytes += text.size();
+
+		// Compiled when the batch is merged, edits are applied once every config is parsed
+		if (CheckRequirements(a_ctx, data))
+			a_ctx.data = std::move(data);
+	} catch (const std::exception& exc) {
+		a_ctx.Log(Level::kError, "Failed to parse " + a_ctx.filename + "\n" + exc.what());
+	}
+}
+
+void ConfigLoader::MergeConfig(FileContext& a_ctx)
+{
+	for (const auto& [level, message] : a_ctx.messages)
+		Log(level, message);
+
+	prefilterStats.skippedConfigs += a_ctx.stats.skippedConfigs;
+	prefilterStats.skippedBytes += a_ctx.stats.skippedBytes;
+	prefilterStats.parsedBytes += a_ctx.stats.parsedBytes;
+	prefilterStats.prefilterTime += a_ctx.stats.prefilterTime;
+	prefilterStats.parseTime += a_ctx.stats.parseTime;
+
+	archiveTexts.erase(*a_ctx.path);
+
+	if (a_ctx.bundle) {
+		configs.emplace_back(std::move(a_ctx.filename), a_ctx.bundle, a_ctx.index);
+	} else if (!a_ctx.data.is_discarded()) {
+		SRD_TRACE_SCOPE("Compile", a_ctx.filename);
+		std::vector<std::string> errors;
+		const auto index = textPack.AddConfig(a_ctx.filename, a_ctx.data, errors);
+		for (const auto& errorMessage : errors)
+			Log(Level::kError, errorMessage);
+		configs.emplace_back(std::move(a_ctx.filename), &textView, index);
+	}
+	a_ctx.data = {};
+}
+
+bool ConfigLoader::CheckRequirements(FileContext& a_ctx, const nlohmann::json& a_data) const
+{
+	std::vector<std::string> requirements;
+	if (const auto list = a_data.find("Requirements"); list != a_data.end()) {
+		for (const auto& record : *list) {
+			if (const auto string = record.get_ptr<const std::string*>())
+				requirements.emplace_back(*string);
+		}
+	}
+
+	const auto missing = Requirements::GetMissing(requirements, isLoaded);
+	for (const auto& requirement : missing)
+		a_ctx.Log(Level::kDebug, "	Missing requirement " + requirement);
+
+	return missing.empty();
+}
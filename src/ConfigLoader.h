@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Archive.h"
+#include "ConfigPack.h"
+#include "WorkerPool.h"
+
+// Finds, matches and parses configs. Does not touch the game, the plugin and the offline tools run the same
+// scan/match/requirements/plan steps and only differ in how plugins are listed and how forms are resolved.
+class ConfigLoader
+{
+public:
+	enum class Level
+	{
+		kDebug,  // one line per config, dropped at the default log level
+		kInfo,
+		kWarning,
+		kError  // the plugin also shows these in a message box
+	};
+
+	using IsLoadedFunc = std::function<bool(std::string_view)>;
+	using LogFunc = std::function<void(Level, const std::string&)>;
+
+	// A config that passed its requirements, in priority order
+	struct Config
+	{
+		std::string filename;
+		const Pack::View* pack;
+		std::uint32_t index;
+	};
+
+	struct PrefilterStats
+	{
+		std::size_t skippedConfigs = 0;
+		std::size_t skippedBytes = 0;
+		std::size_t parsedBytes = 0;
+		std::chrono::steady_clock::duration prefilterTime{};
+		std::chrono::steady_clock::duration parseTime{};
+	};
+
+	// A record of one config together with the form it resolved to
+	template <class Form>
+	struct Task
+	{
+		Form form;
+		const Pack::Record* record;
+		std::uint32_t config;
+	};
+
+	ConfigLoader(IsLoadedFunc a_isLoaded, LogFunc a_log);
+	ConfigLoader(const ConfigLoader&) = delete;  // configs point into textView
+
+	ConfigLoader& operator=(const ConfigLoader&) = delete;
+
+	// a_archives are searched too, in load order. Loose and bundled configs override archived ones of the same name,
+	// later archives override earlier ones.
+	std::pair<std::set<std::string>, std::set<std::string>> ScanConfigDirectory(const std::filesystem::path& a_folder, std::span<const std::filesystem::path> a_archives = {});
+	std::map<std::string, std::set<std::string>> MatchPluginConfigs(const std::set<std::string>& a_pluginConfigs, std::span<const std::string> a_plugins);
+	// Parses the configs of every plugin in a_pluginMap order, then the general configs, as one list on one worker pool
+	void ParseAllConfigs(const std::map<std::string, std::set<std::string>>& a_pluginMap, const std::set<std::string>& a_generalConfigs);
+
+	// Groups the records of every config by section and orders them by form. a_resolve(config, record) returns the
+	// target form or a falsy value to drop the record, a_match(config, record) returns the forms a rule record
+	// matched, a_key(form) gives the sort key. Sorting is stable so records of the same form stay in config priority order.
+	template <class Form, class Resolve, class Match, class Key>
+	std::vector<std::vector<Task<Form>>> PlanRecords(Resolve&& a_resolve, Match&& a_match, Key&& a_key) const
+	{
+		std::vector<std::vector<Task<Form>>> sectionTasks(static_cast<std::size_t>(Schema::Section::kTotal));
+
+		for (std::uint32_t i = 0; i < configs.size(); i++) {
+			const auto& pack = *configs[i].pack;
+			for (const auto& record : pack.GetRecords(pack.configs[configs[i].index])) {
+				auto& tasks = sectionTasks[static_cast<std::size_t>(record.section)];
+				if (record.IsRule()) {
+					for (const auto& form : a_match(i, record))
+						tasks.emplace_back(form, &record, i);
+				} else if (auto form = a_resolve(i, record)) {
+					tasks.emplace_back(std::move(form), &record, i);
+				}
+			}
+		}
+
+		for (auto& tasks : sectionTasks)
+			std::ranges::stable_sort(tasks, {}, [&](const Task<Form>& a_task) { return a_key(a_task.form); });
+
+		return sectionTasks;
+	}
+
+	std::vector<Config> configs;
+	PrefilterStats prefilterStats;
+
+private:
+	// Everything one config produces while it is parsed on a worker thread. Nothing in here is shared with other
+	// configs, the batch is merged back in config order so the log and the compiled pack don't depend on timing.
+	struct FileContext
+	{
+		void Log(Level a_level, std::string a_message) { messages.emplace_back(a_level, std::move(a_message)); }
+
+		const std::string* path = nullptr;
+		std::string filename;
+		std::vector<std::pair<Level, std::string>> messages;
+		PrefilterStats stats;
+		nlohmann::json data = nlohmann::json::value_t::discarded;  // parsed text config that passed its requirements
+		const Pack::View* bundle = nullptr;                        // bundled config that passed its requirements
+		std::uint32_t index = 0;
+	};
+
+	void Log(Level a_level, const std::string& a_message) const { log(a_level, a_message); }
+
+	// Reads, pre-filters and parses one config, safe to run for several configs at once
+	void ParseConfig(FileContext& a_ctx) const;
+
+	// Logs a parsed config's messages and compiles it into textPack, on the calling thread
+	void MergeConfig(FileContext& a_ctx);
+
+	bool CheckRequirements(FileContext& a_ctx, const nlohmann::json& a_data) const;
+
+	void ScanArchives(std::span<const std::filesystem::path> a_archives, std::set<std::string>& a_knownNames, std::set<std::string>& a_generalConfigs, std::set<std::string>& a_pluginConfigs);
+
+	// Parses a_configs on a_pool, each through its own FileContext, and merges them in a_configs order
+	void ParseConfigs(std::span<const std::string* const> a_configs, WorkerPool& a_pool);
+
+	// Decompresses the archived configs of one batch on a_pool, ahead of parsing it
+	void ReadArchivedConfigs(std::span<const std::string* const> a_configs, WorkerPool& a_pool);
+
+	IsLoadedFunc isLoaded;
+	LogFunc log;
+
+	// Loose text configs are converted into textPack, bundles are mapped and applied in place
+	Pack::Builder textPack;
+	Pack::View textView;
+	std::vector<std::unique_ptr<Pack::Bundle>> bundles;
+	std::unordered_map<std::string, std::pair<const Pack::Bundle*, std::uint32_t>> bundleConfigs;
+
+	// Archived configs are read straight from the mapped archive
+	std::vector<std::unique_ptr<Archive>> archives;
+	std::unordered_map<std::string, std::pair<const Archive*, const Archive::Entry*>> archiveConfigs;
+	mutable std::unordered_map<std::string, std::string> archiveTexts;  // texts are moved out by ParseConfig
+};
@@ -0,0 +1,647 @@
+#include "ConfigPack.h"
+
+namespace
+{
+	template <class T>
+	auto ToSpan(const std::vector<T>& a_vector) -> std::span<const T>
+	{
+		return { a_vector.data(), a_vector.size() };
+	}
+
+	auto ParseRegionSoundFlags(std::string_view a_flags) -> std::uint8_t
+	{
+		std::uint8_t result = 0;
+		while (!a_flags.empty()) {
+			const auto end = a_flags.find(' ');
+			const auto flag = a_flags.substr(0, end);
+			for (std::size_t i = 0; i < std::size(Schema::regionSoundFlags); i++) {
+				if (flag == Schema::regionSoundFlags[i])
+					result |= static_cast<std::uint8_t>(1 << i);
+			}
+			if (end == std::string_view::npos)
+				break;
+			a_flags.remove_prefix(end + 1);
+		}
+		return result;
+	}
+
+	// a_object[a_key] as a list of strings, a lone string counts as a list of one. A missing key is an empty list.
+	// Stops at the first problem a_function returns.
+	template <class F>
+	auto ForEachString(const nlohmann::json& a_object, std::string_view a_key, F&& a_function) -> Pack::Problem
+	{
+		const auto list = a_object.find(a_key);
+		if (list == a_object.end())
+			return {};
+		if (const auto string = list->get_ptr<const std::string*>())
+			return a_function(*string);
+		if (!list->is_array())
+			return { Pack::Error::kNotAList, a_key };
+		for (const auto& value : *list) {
+			const auto string = value.get_ptr<const std::string*>();
+			if (!string)
+				return { Pack::Error::kNotAString, a_key };
+			if (const auto problem = a_function(*string))
+				return problem;
+		}
+		return {};
+	}
+}
+
+std::string_view Pack::View::GetString(std::uint32_t a_index) const
+{
+	const auto& string = strings[a_index];
+	return { chars.data() + string.offset, string.length };
+}
+
+std::vector<std::string> Pack::View::GetRequirements(const Config& a_config) const
+{
+	std::vector<std::string> result;
+	for (const auto requirement : requirements.subspan(a_config.firstRequirement, a_config.requirementCount))
+		result.emplace_back(GetString(requirement));
+	return result;
+}
+
+std::string Pack::View::FormatIdentifier(std::uint32_t a_identifier) const
+{
+	const auto& identifier = identifiers[a_identifier];
+	if (identifier.IsEditorID())
+		return std::string(GetString(identifier.value));
+
+	char id[16];
+	const auto end = std::to_chars(std::begin(id), std::end(id), identifier.value, 16).ptr;
+	return std::string(GetString(identifier.plugin)) + "|0x" + std::string(id, end);
+}
+
+std::uint32_t Pack::Builder::InternString(std::string_view a_string)
+{
+	auto [it, inserted] = stringIndex.try_emplace(std::string(a_string), static_cast<std::uint32_t>(strings.size()));
+	if (inserted) {
+		strings.emplace_back(static_cast<std::uint32_t>(chars.size()), static_cast<std::uint32_t>(a_string.size()));
+		chars.insert(chars.end(), a_string.begin(), a_string.end());
+	}
+	return it->second;
+}
+
+Pack::Problem Pack::Builder::InternIdentifier(std::string_view a_identifier, std::string_view a_key, std::uint32_t& a_index)
+{
+	Identifier identifier{ kNone, 0 };
+
+	// Same rule as the plugin has always used, plugin|FormID when both a plugin extension and a separator are present
+	const auto separator = a_identifier.find('|');
+	if (a_identifier.contains(".es") && separator != std::string_view::npos) {
+		auto id = a_identifier.substr(separator + 1);
+		if (id.starts_with("0x") || id.starts_with("0X"))
+			id.remove_prefix(2);
+		std::uint32_t localID = 0;
+		const auto [end, error] = std::from_chars(id.data(), id.data() + id.size(), localID, 16);
+		if (error != std::errc() || end != id.data() + id.size())
+			return { Error::kBadFormID, a_key };
+		identifier = { InternString(a_identifier.substr(0, separator)), localID };
+	} else {
+		identifier.value = InternString(a_identifier);
+	}
+
+	const auto key = (static_cast<std::uint64_t>(identifier.plugin) << 32) | identifier.value;
+	auto [it, inserted] = identifierIndex.try_emplace(key, static_cast<std::uint32_t>(identifiers.size()));
+	if (inserted)
+		identifiers.push_back(identifier);
+	a_index = it->second;
+	return {};
+}
+
+std::string Pack::Problem::GetMessage() const
+{
+	const std::string name(key);
+	switch (error) {
+	case Error::kNotAnObject:
+		return name + " must be an object";
+	case Error::kNotAList:
+		return name + " must be a list";
+	case Error::kNotAString:
+		return name + " must be a string";
+	case Error::kNotANumber:
+		return name + " must be a number";
+	case Error::kMissingKey:
+		return name + " is missing";
+	case Error::kNotASound:
+		return name + " is not a sound, it can't take a pool";
+	case Error::kEmptyPool:
+		return name + " has an empty pool";
+	case Error::kNotASingleSound:
+		return name + " must be a single sound";
+	case Error::kBadFormID:
+		return name + " has a malformed form ID";
+	default:
+		return {};
+	}
+}
+
+Pack::Problem Pack::Builder::GetFieldValue(const nlohmann::json& a_value, std::string_view a_key, std::uint32_t& a_identifier)
+{
+	if (a_value.is_null()) {
+		a_identifier = kNone;
+		return {};
+	}
+	const auto string = a_value.get_ptr<const std::string*>();
+	if (!string)
+		return { Error::kNotAString, a_key };
+	return InternIdentifier(*string, a_key, a_identifier);
+}
+
+Pack::Problem Pack::Builder::GetPoolMembers(const nlohmann::json& a_pool, std::string_view a_key, std::vector<PoolMember>& a_members)
+{
+	using Key = Schema::PoolKey;
+
+	for (const auto& member : a_pool) {
+		if (const auto string = member.get_ptr<const std::string*>()) {
+			if (const auto problem = InternIdentifier(*string, a_key, a_members.emplace_back(kNone, 1.0f).sound))
+				return problem;
+			continue;
+		}
+		if (!member.is_object())
+			return { Error::kNotAString, a_key };
+
+		const auto sound = member.find(Schema::GetPoolKey(Key::kSound));
+		if (sound == member.end())
+			return { Error::kMissingKey, Schema::GetPoolKey(Key::kSound) };
+		if (!sound->is_string())
+			return { Error::kNotAString, Schema::GetPoolKey(Key::kSound) };
+
+		float weight = 1.0f;
+		if (const auto value = member.find(Schema::GetPoolKey(Key::kWeight)); value != member.end()) {
+			if (!value->is_number())
+				return { Error::kNotANumber, Schema::GetPoolKey(Key::kWeight) };
+			weight = value->get<float>();
+		}
+		if (const auto problem = InternIdentifier(sound->get_ref<const std::string&>(), a_key, a_members.emplace_back(kNone, weight).sound))
+			return problem;
+	}
+	if (a_members.empty())
+		return { Error::kEmptyPool, a_key };
+	return {};
+}
+
+Pack::Problem Pack::Builder::AddRule(const nlohmann::json& a_rule, std::uint32_t& a_index)
+{
+	if (!a_rule.is_object())
+		return { Error::kNotAnObject, Schema::GetRuleKey(Schema::RuleKey::kRule) };
+
+	Rule rule{};
+	const auto addList = [&](Schema::RuleKey a_key, bool a_identifiers, std::uint32_t& a_first, std::uint32_t& a_count) -> Problem {
+		a_first = static_cast<std::uint32_t>(ruleValues.size());
+		const auto problem = ForEachString(a_rule, Schema::GetRuleKey(a_key), [&](const std::string& a_string) -> Problem {
+			if (!a_identifiers) {
+				ruleValues.push_back(InternString(a_string));
+				return {};
+			}
+			return InternIdentifier(a_string, Schema::GetRuleKey(a_key), ruleValues.emplace_back());
+		});
+		a_count = static_cast<std::uint32_t>(ruleValues.size()) - a_first;
+		return problem;
+	};
+	if (const auto problem = addList(Schema::RuleKey::kKeywords, true, rule.firstKeyword, rule.keywordCount))
+		return problem;
+	if (const auto problem = addList(Schema::RuleKey::kExcludeKeywords, true, rule.firstExcludedKeyword, rule.excludedKeywordCount))
+		return problem;
+	if (const auto problem = addList(Schema::RuleKey::kPlugins, false, rule.firstPlugin, rule.pluginCount))
+		return problem;
+
+	rule.editorID = kNone;
+	if (const auto editorID = a_rule.find(Schema::GetRuleKey(Schema::RuleKey::kEditorID)); editorID != a_rule.end()) {
+		if (!editorID->is_string())
+			return { Error::kNotAString, Schema::GetRuleKey(Schema::RuleKey::kEditorID) };
+		rule.editorID = InternString(editorID->get_ref<const std::string&>());
+	}
+
+	rules.push_back(rule);
+	a_index = static_cast<std::uint32_t>(rules.size() - 1);
+	return {};
+}
+
+Pack::Problem Pack::Builder::AddRecord(Schema::Section a_section, const nlohmann::json& a_record)
+{
+	if (!a_record.is_object())
+		return { Error::kNotAnObject, "Entry"sv };
+
+	// Only commit once the whole record converted, a bad value skips the record instead of leaving half of it
+	const auto ruleCount = rules.size();
+	const auto ruleValueCount = ruleValues.size();
+	const auto fail = [&](Problem a_problem) {
+		rules.resize(ruleCount);
+		ruleValues.resize(ruleValueCount);
+		return a_problem;
+	};
+
+	Record record{};
+	if (const auto rule = a_record.find(Schema::GetRuleKey(Schema::RuleKey::kRule)); rule != a_record.end()) {
+		record.target = Record::Target::kRule;
+		if (const auto problem = AddRule(*rule, record.form))
+			return fail(problem);
+	} else {
+		const auto form = a_record.find("Form");
+		if (form == a_record.end())
+			return { Error::kMissingKey, "Form"sv };
+		if (!form->is_string())
+			return { Error::kNotAString, "Form"sv };
+		if (const auto problem = InternIdentifier(form->get_ref<const std::string&>(), "Form"sv, record.form))
+			return problem;
+	}
+	record.section = a_section;
+	record.firstField = static_cast<std::uint32_t>(fields.size());
+
+	std::vector<Field> recordFields;
+	std::vector<std::vector<PoolMember>> recordPools;
+
+	if (a_section == Schema::Section::kRegions) {
+		const auto rdsaKey = Schema::GetFieldName(a_section, static_cast<std::uint16_t>(Schema::RegionField::kRDSA));
+		if (const auto rdsaList = a_record.find(rdsaKey); rdsaList != a_record.end()) {
+			if (!rdsaList->is_array())
+				return fail({ Error::kNotAList, rdsaKey });
+			for (const auto& rdsa : *rdsaList) {
+				if (!rdsa.is_object())
+					return fail({ Error::kNotAnObject, rdsaKey });
+				const auto sound = rdsa.find(Schema::regionSoundKeys[0]);
+				if (sound == rdsa.end())
+					continue;
+
+				Field field{};
+				field.key = static_cast<std::uint16_t>(Schema::RegionField::kRDSA);
+				if (const auto problem = GetFieldValue(*sound, Schema::regionSoundKeys[0], field.value))
+					return fail(problem);
+				if (const auto flags = rdsa.find(Schema::regionSoundKeys[1]); flags != rdsa.end()) {
+					if (!flags->is_string())
+						return fail({ Error::kNotAString, Schema::regionSoundKeys[1] });
+					field.presence |= Field::kFlags;
+					field.flags = ParseRegionSoundFlags(flags->get_ref<const std::string&>());
+				}
+				if (const auto chance = rdsa.find(Schema::regionSoundKeys[2]); chance != rdsa.end()) {
+					if (!chance->is_number())
+						return fail({ Error::kNotANumber, Schema::regionSoundKeys[2] });
+					field.presence |= Field::kChance;
+					field.chance = chance->get<float>();
+				}
+				recordFields.push_back(field);
+			}
+		}
+	} else {
+		// One pass over the record's keys, fields are still added in schema order
+		std::array<const nlohmann::json*, Schema::FieldLookup::kMaxFields> values{};
+		for (auto it = a_record.begin(); it != a_record.end(); ++it) {
+			if (const auto key = Schema::FindField(a_section, it.key()); key != Schema::kNoField)
+				values[key] = &it.value();
+		}
+
+		const auto& names = Schema::GetSection(a_section).fields;
+		for (std::uint16_t key = 0; key < names.size(); key++) {
+			const auto value = values[key];
+			if (!value)
+				continue;
+
+			Field field{};
+			field.key = key;
+			if (value->is_array()) {
+				if (Schema::GetFieldRecord(a_section, key) != "SNDR")
+					return fail({ Error::kNotASound, names[key] });
+				field.presence = Field::kPool;
+				field.value = static_cast<std::uint32_t>(pools.size() + recordPools.size());
+				if (const auto problem = GetPoolMembers(*value, names[key], recordPools.emplace_back()))
+					return fail(problem);
+			} else if (const auto problem = GetFieldValue(*value, names[key], field.value)) {
+				return fail(problem);
+			}
+			recordFields.push_back(field);
+		}
+	}
+
+	fields.insert(fields.end(), recordFields.begin(), recordFields.end());
+	for (const auto& members : recordPools) {
+		pools.emplace_back(static_cast<std::uint32_t>(poolMembers.size()), static_cast<std::uint32_t>(members.size()));
+		poolMembers.insert(poolMembers.end(), members.begin(), members.end());
+	}
+	record.fieldCount = static_cast<std::uint32_t>(recordFields.size());
+	records.push_back(record);
+	return {};
+}
+
+Pack::Problem Pack::Builder::AddDescriptor(const nlohmann::json& a_descriptor)
+{
+	using Key = Schema::DescriptorKey;
+
+	if (!a_descriptor.is_object())
+		return { Error::kNotAnObject, "Entry"sv };
+
+	Descriptor descriptor{};
+	const auto name = a_descriptor.find(Schema::GetDescriptorKey(Key::kName));
+	if (name == a_descriptor.end())
+		return { Error::kMissingKey, Schema::GetDescriptorKey(Key::kName) };
+	if (!name->is_string())
+		return { Error::kNotAString, Schema::GetDescriptorKey(Key::kName) };
+	descriptor.name = InternString(name->get_ref<const std::string&>());
+
+	descriptor.category = kNone;
+	descriptor.outputModel = kNone;
+	if (const auto category = a_descriptor.find(Schema::GetDescriptorKey(Key::kCategory)); category != a_descriptor.end()) {
+		if (const auto problem = GetFieldValue(*category, Schema::GetDescriptorKey(Key::kCategory), descriptor.category))
+			return problem;
+	}
+	// The game plays a descriptor through its output model, there is no default to fall back to
+	const auto outputModel = a_descriptor.find(Schema::GetDescriptorKey(Key::kOutputModel));
+	if (outputModel == a_descriptor.end() || outputModel->is_null())
+		return { Error::kMissingKey, Schema::GetDescriptorKey(Key::kOutputModel) };
+	if (const auto problem = GetFieldValue(*outputModel, Schema::GetDescriptorKey(Key::kOutputModel), descriptor.outputModel))
+		return problem;
+	if (const auto attenuation = a_descriptor.find(Schema::GetDescriptorKey(Key::kStaticAttenuation)); attenuation != a_descriptor.end()) {
+		if (!attenuation->is_number())
+			return { Error::kNotANumber, Schema::GetDescriptorKey(Key::kStaticAttenuation) };
+		descriptor.staticAttenuation = attenuation->get<float>();
+	}
+
+	std::vector<std::uint32_t> files;
+	if (const auto problem = ForEachString(a_descriptor, Schema::GetDescriptorKey(Key::kFiles), [&](const std::string& a_file) {
+			files.push_back(InternString(a_file));
+			return Problem{};
+		}))
+		return problem;
+
+	// Same as records, only commit once the whole descriptor converted
+	descriptor.firstFile = static_cast<std::uint32_t>(descriptorFiles.size());
+	descriptor.fileCount = static_cast<std::uint32_t>(files.size());
+	descriptorFiles.insert(descriptorFiles.end(), files.begin(), files.end());
+	descriptors.push_back(descriptor);
+	return {};
+}
+
+Pack::Problem Pack::Builder::AddReplacement(const nlohmann::json& a_replacement)
+{
+	using Key = Schema::ReplaceKey;
+
+	if (!a_replacement.is_object())
+		return { Error::kNotAnObject, "Entry"sv };
+
+	const auto sound = a_replacement.find(Schema::GetReplaceKey(Key::kSound));
+	if (sound == a_replacement.end())
+		return { Error::kMissingKey, Schema::GetReplaceKey(Key::kSound) };
+	if (!sound->is_string())
+		return { Error::kNotAString, Schema::GetReplaceKey(Key::kSound) };
+
+	const auto with = a_replacement.find(Schema::GetReplaceKey(Key::kWith));
+	if (with == a_replacement.end())
+		return { Error::kMissingKey, Schema::GetReplaceKey(Key::kWith) };
+	if (with->is_array())
+		return { Error::kNotASingleSound, Schema::GetReplaceKey(Key::kWith) };
+	if (!with->is_string())
+		return { Error::kNotAString, Schema::GetReplaceKey(Key::kWith) };
+
+	Replacement replacement{};
+	if (const auto problem = InternIdentifier(sound->get_ref<const std::string&>(), Schema::GetReplaceKey(Key::kSound), replacement.sound))
+		return problem;
+	if (const auto problem = InternIdentifier(with->get_ref<const std::string&>(), Schema::GetReplaceKey(Key::kWith), replacement.with))
+		return problem;
+	replacements.push_back(replacement);
+	return {};
+}
+
+std::uint32_t Pack::Builder::AddConfig(std::string_view a_name, const nlohmann::json& a_data, std::vector<std::string>& a_errors)
+{
+	Config config{};
+	config.name = InternString(a_name);
+	config.firstRequirement = static_cast<std::uint32_t>(requirements.size());
+	config.firstRecord = static_cast<std::uint32_t>(records.size());
+	config.firstDescriptor = static_cast<std::uint32_t>(descriptors.size());
+	config.firstReplacement = static_cast<std::uint32_t>(replacements.size());
+
+	if (const auto requirementList = a_data.find("Requirements"); requirementList != a_data.end()) {
+		for (const auto& requirement : *requirementList) {
+			if (const auto string = requirement.get_ptr<const std::string*>())
+				requirements.push_back(InternString(*string));
+		}
+	}
+
+	// Every list is converted the same way, a bad entry is reported and skipped
+	const auto addList = [&](std::string_view a_list, std::string_view a_entry, auto a_add) {
+		const auto list = a_data.find(a_list);
+		if (list == a_data.end())
+			return;
+		if (!list->is_array()) {
+			a_errors.emplace_back("	Failed to parse " + std::string(a_list) + " in " + std::string(a_name) + "\n" + Problem{ Error::kNotAList, a_list }.GetMessage());
+			return;
+		}
+		for (const auto& entry : *list) {
+			if (const auto problem = a_add(entry))
+				a_errors.emplace_back("	Failed to parse " + std::string(a_entry) + " in " + std::string(a_name) + "\n" + problem.GetMessage());
+		}
+	};
+
+	addList(Schema::descriptorSection, "sound descriptor"sv, [&](const nlohmann::json& a_entry) { return AddDescriptor(a_entry); });
+	addList(Schema::replaceSection, "replacement"sv, [&](const nlohmann::json& a_entry) { return AddReplacement(a_entry); });
+	for (std::size_t i = 0; i < std::size(Schema::sections); i++)
+		addList(Schema::sections[i].name, "entry"sv, [&](const nlohmann::json& a_entry) { return AddRecord(static_cast<Schema::Section>(i), a_entry); });
+
+	config.requirementCount = static_cast<std::uint32_t>(requirements.size()) - config.firstRequirement;
+	config.recordCount = static_cast<std::uint32_t>(records.size()) - config.firstRecord;
+	config.descriptorCount = static_cast<std::uint32_t>(descriptors.size()) - config.firstDescriptor;
+	config.replacementCount = static_cast<std::uint32_t>(replacements.size()) - config.firstReplacement;
+
+	configs.push_back(config);
+	return static_cast<std::uint32_t>(configs.size() - 1);
+}
+
+Pack::View Pack::Builder::GetView() const
+{
+	return {
+		ToSpan(chars),
+		ToSpan(strings),
+		ToSpan(identifiers),
+		ToSpan(requirements),
+		ToSpan(configs),
+		ToSpan(records),
+		ToSpan(fields),
+		ToSpan(rules),
+		ToSpan(ruleValues),
+		ToSpan(descriptors),
+		ToSpan(descriptorFiles),
+		ToSpan(pools),
+		ToSpan(poolMembers),
+		ToSpan(replacements)
+	};
+}
+
+bool Pack::Builder::Write(const std::filesystem::path& a_path) const
+{
+	std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+	if (!file.good())
+		return false;
+
+	Header header{};
+	header.magic = kMagic;
+	header.version = kVersion;
+	header.schema = Schema::hash;
+
+	std::uint64_t offset = sizeof(Header);
+	const auto place = [&]<class T>(Header::Block& a_block, const std::vector<T>& a_data) {
+		offset = (offset + 7) & ~std::uint64_t(7);
+		a_block = { offset, a_data.size() };
+		offset += a_data.size() * sizeof(T);
+	};
+	place(header.chars, chars);
+	place(header.strings, strings);
+	place(header.identifiers, identifiers);
+	place(header.requirements, requirements);
+	place(header.configs, configs);
+	place(header.records, records);
+	place(header.fields, fields);
+	place(header.rules, rules);
+	place(header.ruleValues, ruleValues);
+	place(header.descriptors, descriptors);
+	place(header.descriptorFiles, descriptorFiles);
+	place(header.pools, pools);
+	place(header.poolMembers, poolMembers);
+	place(header.replacements, replacements);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+	std::uint64_t written = sizeof(Header);
+	const auto write = [&]<class T>(const Header::Block& a_block, const std::vector<T>& a_data) {
+		static constexpr char padding[8]{};
+		file.write(padding, static_cast<std::streamsize>(a_block.offset - written));
+		file.write(reinterpret_cast<const char*>(a_data.data()), static_cast<std::streamsize>(a_data.size() * sizeof(T)));
+		written = a_block.offset + a_data.size() * sizeof(T);
+	};
+	write(header.chars, chars);
+	write(header.strings, strings);
+	write(header.identifiers, identifiers);
+	write(header.requirements, requirements);
+	write(header.configs, configs);
+	write(header.records, records);
+	write(header.fields, fields);
+	write(header.rules, rules);
+	write(header.ruleValues, ruleValues);
+	write(header.descriptors, descriptors);
+	write(header.descriptorFiles, descriptorFiles);
+	write(header.pools, pools);
+	write(header.poolMembers, poolMembers);
+	write(header.replacements, replacements);
+
+	return file.good();
+}
+
+bool Pack::Bundle::Open(const std::filesystem::path& a_path, std::string& a_error)
+{
+	if (!file.Open(a_path)) {
+		a_error = "failed to map file";
+		return false;
+	}
+
+	const auto data = file.GetData();
+	if (data.size() < sizeof(Header)) {
+		a_error = "file is too small";
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data.data(), sizeof(Header));
+	if (header.magic != kMagic) {
+		a_error = "not an SRD bundle";
+		return false;
+	}
+	if (header.version != kVersion || header.schema != Schema::hash) {
+		a_error = "bundle was compiled for another version of SRD, recompile it";
+		return false;
+	}
+
+	bool valid = true;
+	const auto map = [&]<class T>(std::span<const T>& a_span, const Header::Block& a_block) {
+		if (a_block.offset % alignof(T) != 0 || a_block.offset > data.size() || a_block.count > (data.size() - a_block.offset) / sizeof(T)) {
+			valid = false;
+			return;
+		}
+		a_span = { reinterpret_cast<const T*>(data.data() + a_block.offset), static_cast<std::size_t>(a_block.count) };
+	};
+	map(view.chars, header.chars);
+	map(view.strings, header.strings);
+	map(view.identifiers, header.identifiers);
+	map(view.requirements, header.requirements);
+	map(view.configs, header.configs);
+	map(view.records, header.records);
+	map(view.fields, header.fields);
+	map(view.rules, header.rules);
+	map(view.ruleValues, header.ruleValues);
+	map(view.descriptors, header.descriptors);
+	map(view.descriptorFiles, header.descriptorFiles);
+	map(view.pools, header.pools);
+	map(view.poolMembers, header.poolMembers);
+	map(view.replacements, header.replacements);
+
+	// Everything the loader indexes is checked once here, so a damaged bundle can't make the apply step read out of bounds
+	const auto inRange = [](std::uint64_t a_first, std::uint64_t a_count, std::size_t a_size) {
+		return a_first <= a_size && a_count <= a_size - a_first;
+	};
+	const auto isString = [&](std::uint32_t a_index) { return a_index < view.strings.size(); };
+	const auto isValue = [&](std::uint32_t a_index) { return a_index == kNone || a_index < view.identifiers.size(); };
+
+	if (valid) {
+		for (const auto& string : view.strings)
+			valid &= inRange(string.offset, string.length, view.chars.size());
+		for (const auto& identifier : view.identifiers)
+			valid &= identifier.IsEditorID() ? isString(identifier.value) : isString(identifier.plugin);
+		for (const auto requirement : view.requirements)
+			valid &= isString(requirement);
+		for (const auto& config : view.configs) {
+			valid &= isString(config.name);
+			valid &= inRange(config.firstRequirement, config.requirementCount, view.requirements.size());
+			valid &= inRange(config.firstRecord, config.recordCount, view.records.size());
+			valid &= inRange(config.firstDescriptor, config.descriptorCount, view.descriptors.size());
+			valid &= inRange(config.firstReplacement, config.replacementCount, view.replacements.size());
+		}
+		for (const auto& descriptor : view.descriptors) {
+			valid &= isString(descriptor.name) && isValue(descriptor.category) && isValue(descriptor.outputModel);
+			valid &= inRange(descriptor.firstFile, descriptor.fileCount, view.descriptorFiles.size());
+		}
+		for (const auto file : view.descriptorFiles)
+			valid &= isString(file);
+		for (const auto& pool : view.pools)
+			valid &= inRange(pool.firstMember, pool.memberCount, view.poolMembers.size());
+		for (const auto& member : view.poolMembers)
+			valid &= member.sound < view.identifiers.size();
+		for (const auto& replacement : view.replacements)
+			valid &= replacement.sound < view.identifiers.size() && replacement.with < view.identifiers.size();
+		for (const auto& rule : view.rules) {
+			valid &= inRange(rule.firstKeyword, rule.keywordCount, view.ruleValues.size());
+			valid &= inRange(rule.firstExcludedKeyword, rule.excludedKeywordCount, view.ruleValues.size());
+			valid &= inRange(rule.firstPlugin, rule.pluginCount, view.ruleValues.size());
+			valid &= rule.editorID == kNone || isString(rule.editorID);
+		}
+		for (const auto& record : view.records) {
+			valid &= record.IsRule() ? record.form < view.rules.size() : record.form < view.identifiers.size();
+			valid &= record.target <= Record::Target::kRule;
+			valid &= record.section < Schema::Section::kTotal;
+			valid &= inRange(record.firstField, record.fieldCount, view.fields.size());
+		}
+	}
+	if (valid) {
+		for (const auto& record : view.records) {
+			for (const auto& field : view.GetFields(record)) {
+				valid &= (field.presence & Field::kPool) ? field.value < view.pools.size() : isValue(field.value);
+				valid &= field.key < Schema::GetSection(record.section).fields.size();
+			}
+		}
+		for (const auto& rule : view.rules) {
+			for (const auto keyword : view.GetKeywords(rule))
+				valid &= keyword < view.identifiers.size();
+			for (const auto keyword : view.GetExcludedKeywords(rule))
+				valid &= keyword < view.identifiers.size();
+			for (const auto plugin : view.GetPlugins(rule))
+				valid &= isString(plugin);
+		}
+	}
+
+	if (!valid) {
+		view = {};
+		file.Close();
+		a_error = "bundle is damaged";
+		return false;
+	}
+
+	return true;
+}
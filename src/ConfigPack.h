@@ -0,0 +1,269 @@
+#pragma once
+
+#include "ConfigSchema.h"
+#include "MappedFile.h"
+
+#include <nlohmann/json.hpp>
+
+// Flat form of parsed configs with interned strings and pre-split identifiers. Text configs are converted into it
+// at load, and the offline compiler writes it out as a bundle that the plugin maps and applies without text parsing.
+namespace Pack
+{
+	inline constexpr std::uint32_t kNone = 0xFFFFFFFF;
+	inline constexpr std::uint32_t kMagic = 0x42445253;  // "SRDB"
+	inline constexpr std::uint32_t kVersion = 5;
+
+	struct StringRef
+	{
+		std::uint32_t offset;
+		std::uint32_t length;
+	};
+
+	// plugin|FormID identifiers are stored as plugin name and local form ID, EditorIDs as the name only
+	struct Identifier
+	{
+		std::uint32_t plugin;  // string, kNone for EditorIDs
+		std::uint32_t value;   // local form ID, or the EditorID string
+
+		bool IsEditorID() const { return plugin == kNone; }
+	};
+
+	struct Field
+	{
+		enum Presence : std::uint8_t
+		{
+			kFlags = 1 << 0,   // region sounds only
+			kChance = 1 << 1,  // region sounds only
+			kPool = 1 << 2     // value is a pool index
+		};
+
+		std::uint32_t value;    // identifier, kNone clears the field
+		std::uint16_t key;      // index into the section's field names
+		std::uint8_t presence;
+		std::uint8_t flags;     // region sounds only, bits follow Schema::regionSoundFlags
+		float chance;           // region sounds only
+	};
+	static_assert(sizeof(Field) == 12);
+
+	struct Record
+	{
+		enum class Target : std::uint8_t
+		{
+			kForm,
+			kRule
+		};
+
+		std::uint32_t form;  // identifier, or rule index for rule records
+		std::uint32_t firstField;
+		std::uint32_t fieldCount;
+		Schema::Section section;
+		Target target;
+		std::uint8_t pad0E[2];
+
+		bool IsRule() const { return target == Target::kRule; }
+		// Most conflict entries applying the record to one form adds: one per field, two per region sound (flags and chance)
+		std::size_t GetMaxConflicts() const { return section == Schema::Section::kRegions ? fieldCount * std::size_t{ 2 } : fieldCount; }
+	};
+	static_assert(sizeof(Record) == 16);
+
+	// Filters of a rule record, lists index into View::ruleValues
+	struct Rule
+	{
+		std::uint32_t firstKeyword;  // identifiers
+		std::uint32_t keywordCount;
+		std::uint32_t firstExcludedKeyword;  // identifiers
+		std::uint32_t excludedKeywordCount;
+		std::uint32_t firstPlugin;  // strings
+		std::uint32_t pluginCount;
+		std::uint32_t editorID;  // string, kNone matches every form
+	};
+	static_assert(sizeof(Rule) == 28);
+
+	// Weighted sounds of a pool field, members index into View::poolMembers
+	struct Pool
+	{
+		std::uint32_t firstMember;
+		std::uint32_t memberCount;
+	};
+	static_assert(sizeof(Pool) == 8);
+
+	struct PoolMember
+	{
+		std::uint32_t sound;  // identifier
+		float weight;
+	};
+	static_assert(sizeof(PoolMember) == 8);
+
+	// A sound descriptor defined by a config, files index into View::descriptorFiles
+	struct Descriptor
+	{
+		std::uint32_t name;         // string
+		std::uint32_t category;     // identifier, kNone leaves it unset
+		std::uint32_t outputModel;  // identifier, kNone leaves it unset
+		std::uint32_t firstFile;    // strings
+		std::uint32_t fileCount;
+		float staticAttenuation;    // dB
+	};
+	static_assert(sizeof(Descriptor) == 24);
+
+	// A Replace entry, every use of sound becomes with
+	struct Replacement
+	{
+		std::uint32_t sound;  // identifier
+		std::uint32_t with;   // identifier
+	};
+	static_assert(sizeof(Replacement) == 8);
+
+	struct Config
+	{
+		std::uint32_t name;  // string
+		std::uint32_t firstRequirement;
+		std::uint32_t requirementCount;
+		std::uint32_t firstRecord;
+		std::uint32_t recordCount;
+		std::uint32_t firstDescriptor;
+		std::uint32_t descriptorCount;
+		std::uint32_t firstReplacement;
+		std::uint32_t replacementCount;
+	};
+	static_assert(sizeof(Config) == 36);
+
+	// Why the builder skipped part of a config. Values are type checked instead of converted through exceptions, so a
+	// malformed entry costs about as much as a valid one.
+	enum class Error : std::uint8_t
+	{
+		kNone,
+		kNotAnObject,
+		kNotAList,
+		kNotAString,
+		kNotANumber,
+		kMissingKey,
+		kNotASound,       // a pool in a field that doesn't take sound descriptors
+		kEmptyPool,
+		kNotASingleSound,  // a pool where only one sound is allowed
+		kBadFormID         // plugin|FormID whose form ID isn't hexadecimal
+	};
+
+	struct Problem
+	{
+		Error error = Error::kNone;
+		std::string_view key;  // key the problem was found at, points into Schema or a literal
+
+		explicit operator bool() const { return error != Error::kNone; }
+		std::string GetMessage() const;
+	};
+
+	struct View
+	{
+		std::span<const char> chars;
+		std::span<const StringRef> strings;
+		std::span<const Identifier> identifiers;
+		std::span<const std::uint32_t> requirements;  // strings
+		std::span<const Config> configs;
+		std::span<const Record> records;
+		std::span<const Field> fields;
+		std::span<const Rule> rules;
+		std::span<const std::uint32_t> ruleValues;
+		std::span<const Descriptor> descriptors;
+		std::span<const std::uint32_t> descriptorFiles;
+		std::span<const Pool> pools;
+		std::span<const PoolMember> poolMembers;
+		std::span<const Replacement> replacements;
+
+		std::string_view GetString(std::uint32_t a_index) const;
+		std::span<const Record> GetRecords(const Config& a_config) const { return records.subspan(a_config.firstRecord, a_config.recordCount); }
+		std::span<const Field> GetFields(const Record& a_record) const { return fields.subspan(a_record.firstField, a_record.fieldCount); }
+		std::vector<std::string> GetRequirements(const Config& a_config) const;
+		const Rule& GetRule(const Record& a_record) const { return rules[a_record.form]; }
+		std::span<const std::uint32_t> GetKeywords(const Rule& a_rule) const { return ruleValues.subspan(a_rule.firstKeyword, a_rule.keywordCount); }
+		std::span<const std::uint32_t> GetExcludedKeywords(const Rule& a_rule) const { return ruleValues.subspan(a_rule.firstExcludedKeyword, a_rule.excludedKeywordCount); }
+		std::span<const std::uint32_t> GetPlugins(const Rule& a_rule) const { return ruleValues.subspan(a_rule.firstPlugin, a_rule.pluginCount); }
+		std::span<const Descriptor> GetDescriptors(const Config& a_config) const { return descriptors.subspan(a_config.firstDescriptor, a_config.descriptorCount); }
+		std::span<const std::uint32_t> GetFiles(const Descriptor& a_descriptor) const { return descriptorFiles.subspan(a_descriptor.firstFile, a_descriptor.fileCount); }
+		std::span<const PoolMember> GetMembers(const Pool& a_pool) const { return poolMembers.subspan(a_pool.firstMember, a_pool.memberCount); }
+		std::span<const Replacement> GetReplacements(const Config& a_config) const { return replacements.subspan(a_config.firstReplacement, a_config.replacementCount); }
+
+		// The identifier as it would be written in a config, for messages
+		std::string FormatIdentifier(std::uint32_t a_identifier) const;
+	};
+
+	class Builder
+	{
+	public:
+		// Converts one parsed config. Records that don't match the schema are skipped and reported in a_errors, nothing
+		// in here throws for a malformed config.
+		std::uint32_t AddConfig(std::string_view a_name, const nlohmann::json& a_data, std::vector<std::string>& a_errors);
+
+		View GetView() const;
+		bool Write(const std::filesystem::path& a_path) const;
+
+	private:
+		std::uint32_t InternString(std::string_view a_string);
+		Problem InternIdentifier(std::string_view a_identifier, std::string_view a_key, std::uint32_t& a_index);
+		Problem GetFieldValue(const nlohmann::json& a_value, std::string_view a_key, std::uint32_t& a_identifier);
+		Problem GetPoolMembers(const nlohmann::json& a_pool, std::string_view a_key, std::vector<PoolMember>& a_members);
+		Problem AddRecord(Schema::Section a_section, const nlohmann::json& a_record);
+		Problem AddRule(const nlohmann::json& a_rule, std::uint32_t& a_index);
+		Problem AddDescriptor(const nlohmann::json& a_descriptor);
+		Problem AddReplacement(const nlohmann::json& a_replacement);
+
+		std::vector<char> chars;
+		std::vector<StringRef> strings;
+		std::vector<Identifier> identifiers;
+		std::vector<std::uint32_t> requirements;
+		std::vector<Config> configs;
+		std::vector<Record> records;
+		std::vector<Field> fields;
+		std::vector<Rule> rules;
+		std::vector<std::uint32_t> ruleValues;
+		std::vector<Descriptor> descriptors;
+		std::vector<std::uint32_t> descriptorFiles;
+		std::vector<Pool> pools;
+		std::vector<PoolMember> poolMembers;
+		std::vector<Replacement> replacements;
+
+		std::unordered_map<std::string, std::uint32_t> stringIndex;
+		std::unordered_map<std::uint64_t, std::uint32_t> identifierIndex;
+	};
+
+	// A compiled bundle, mapped read-only
+	class Bundle
+	{
+	public:
+		bool Open(const std::filesystem::path& a_path, std::string& a_error);
+
+		const View& GetView() const { return view; }
+
+	private:
+		MappedFile file;
+		View view;
+	};
+
+	struct Header
+	{
+		struct Block
+		{
+			std::uint64_t offset;
+			std::uint64_t count;
+		};
+
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t schema;  // Schema::hash
+		std::uint32_t pad0C;
+		Block chars;
+		Block strings;
+		Block identifiers;
+		Block requirements;
+		Block configs;
+		Block records;
+		Block fields;
+		Block rules;
+		Block ruleValues;
+		Block descriptors;
+		Block descriptorFiles;
+		Block pools;
+		Block poolMembers;
+		Block replacements;
+	};
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+// Sections and fields of SRD configs. Shared by the plugin and the offline tools, so nothing in here may depend on the game.
+namespace Schema
+{
+	enum class Section : std::uint8_t
+	{
+		kRegions,
+		kWeapons,
+		kMagicEffects,
+		kArmorAddons,
+		kArmors,
+		kMiscItems,
+		kSoulGems,
+		kProjectiles,
+		kExplosions,
+		kEffectShaders,
+		kIngestibles,
+		kAcousticSpaces,
+		kCells,
+		kActivators,
+		kDoors,
+		kContainers,
+		kWater,
+		kWeathers,
+
+		kTotal
+	};
+
+	enum class RegionField : std::uint16_t
+	{
+		kRDSA
+	};
+
+	enum class WeaponField : std::uint16_t
+	{
+		kPickUp,
+		kPutDown,
+		kImpactDataSet,
+		kAttack,
+		kAttack2D,
+		kAttackLoop,
+		kAttackFail,
+		kIdle,
+		kEquip,
+		kUnequip
+	};
+
+	// Matches RE::MagicSystem::SoundID
+	enum class MagicEffectField : std::uint16_t
+	{
+		kSheatheDraw,
+		kCharge,
+		kReady,
+		kRelease,
+		kCastLoop,
+		kOnHit
+	};
+
+	enum class ArmorAddonField : std::uint16_t
+	{
+		kFootstep
+	};
+
+	enum class PickUpPutDownField : std::uint16_t
+	{
+		kPickUp,
+		kPutDown
+	};
+
+	enum class ProjectileField : std::uint16_t
+	{
+		kActive,
+		kCountdown,
+		kDeactivate
+	};
+
+	enum class ExplosionField : std::uint16_t
+	{
+		kInterior,
+		kExterior
+	};
+
+	enum class EffectShaderField : std::uint16_t
+	{
+		kAmbient
+	};
+
+	enum class IngestibleField : std::uint16_t
+	{
+		kConsume
+	};
+
+	enum class AcousticSpaceField : std::uint16_t
+	{
+		kAmbient,
+		kReverb
+	};
+
+	enum class CellField : std::uint16_t
+	{
+		kAcousticSpace,
+		kMusic
+	};
+
+	enum class ActivatorField : std::uint16_t
+	{
+		kLoop,
+		kActivate
+	};
+
+	enum class DoorField : std::uint16_t
+	{
+		kOpen,
+		kClose,
+		kLoop
+	};
+
+	enum class ContainerField : std::uint16_t
+	{
+		kOpen,
+		kClose
+	};
+
+	enum class WaterField : std::uint16_t
+	{
+		kSound
+	};
+
+	// Weather sounds are a list, a field adds its sound with that type or moves it there, null removes every sound of the type
+	enum class WeatherField : std::uint16_t
+	{
+		kDefault,
+		kPrecipitation,
+		kWind,
+		kThunder
+	};
+
+	struct SectionInfo
+	{
+		std::string_view name;
+		std::string_view record;  // signature of the records the section edits
+		std::span<const std::string_view> fields;
+		std::span<const std::string_view> fieldRecords;  // signature of the records each field points to
+	};
+
+	inline constexpr std::string_view regionFields[] = { "RDSA" };
+	inline constexpr std::string_view weaponFields[] = { "Pick Up", "Put Down", "Impact Data Set", "Attack", "Attack 2D", "Attack Loop", "Attack Fail", "Idle", "Equip", "Unequip" };
+	inline constexpr std::string_view magicEffectFields[] = { "Sheathe/Draw", "Charge", "Ready", "Release", "Cast Loop", "On Hit" };
+	inline constexpr std::string_view armorAddonFields[] = { "Footstep" };
+	inline constexpr std::string_view pickUpPutDownFields[] = { "Pick Up", "Put Down" };
+	inline constexpr std::string_view projectileFields[] = { "Active", "Countdown", "Deactivate" };
+	inline constexpr std::string_view explosionFields[] = { "Interior", "Exterior" };
+	inline constexpr std::string_view effectShaderFields[] = { "Ambient" };
+	inline constexpr std::string_view ingestibleFields[] = { "Consume" };
+	inline constexpr std::string_view acousticSpaceFields[] = { "Ambient", "Reverb" };
+	inline constexpr std::string_view cellFields[] = { "Acoustic Space", "Music" };
+	inline constexpr std::string_view activatorFields[] = { "Loop", "Activate" };
+	inline constexpr std::string_view doorFields[] = { "Open", "Close", "Loop" };
+	inline constexpr std::string_view containerFields[] = { "Open", "Close" };
+	inline constexpr std::string_view waterFields[] = { "Sound" };
+	inline constexpr std::string_view weatherFields[] = { "Default", "Precipitation", "Wind", "Thunder" };
+
+	inline constexpr std::string_view soundRecords[] = { "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR" };
+	inline constexpr std::string_view weaponFieldRecords[] = { "SNDR", "SNDR", "IPDS", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR", "SNDR" };
+	inline constexpr std::string_view armorAddonFieldRecords[] = { "FSTS" };
+	inline constexpr std::string_view acousticSpaceFieldRecords[] = { "SNDR", "REVB" };
+	inline constexpr std::string_view cellFieldRecords[] = { "ASPC", "MUSC" };
+
+	inline constexpr SectionInfo sections[] = {
+		{ "Regions", "REGN", regionFields, soundRecords },
+		{ "Weapons", "WEAP", weaponFields, weaponFieldRecords },
+		{ "Magic Effects", "MGEF", magicEffectFields, soundRecords },
+		{ "Armor Addons", "ARMA", armorAddonFields, armorAddonFieldRecords },
+		{ "Armors", "ARMO", pickUpPutDownFields, soundRecords },
+		{ "Misc. Items", "MISC", pickUpPutDownFields, soundRecords },
+		{ "Soul Gems", "SLGM", pickUpPutDownFields, soundRecords },
+		{ "Projectiles", "PROJ", projectileFields, soundRecords },
+		{ "Explosions", "EXPL", explosionFields, soundRecords },
+		{ "Effect Shaders", "EFSH", effectShaderFields, soundRecords },
+		{ "Ingestibles", "ALCH", ingestibleFields, soundRecords },
+		{ "Acoustic Spaces", "ASPC", acousticSpaceFields, acousticSpaceFieldRecords },
+		{ "Cells", "CELL", cellFields, cellFieldRecords },
+		{ "Activators", "ACTI", activatorFields, soundRecords },
+		{ "Doors", "DOOR", doorFields, soundRecords },
+		{ "Containers", "CONT", containerFields, soundRecords },
+		{ "Water", "WATR", waterFields, soundRecords },
+		{ "Weathers", "WTHR", weatherFields, soundRecords },
+	};
+	static_assert(std::size(sections) == static_cast<std::size_t>(Section::kTotal));
+
+	inline constexpr std::uint16_t kNoField = 0xFFFF;
+
+	// Field names of one section sorted at compile time, a record's keys are matched in one pass over the record
+	struct FieldLookup
+	{
+		static constexpr std::size_t kMaxFields = 10;
+
+		std::array<std::pair<std::string_view, std::uint16_t>, kMaxFields> fields{};
+		std::size_t size = 0;
+
+		constexpr auto Find(std::string_view a_name) const -> std::uint16_t
+		{
+			const auto end = fields.begin() + size;
+			const auto it = std::lower_bound(fields.begin(), end, a_name, [](const auto& a_field, std::string_view a_key) { return a_field.first < a_key; });
+			return it != end && it->first == a_name ? it->second : kNoField;
+		}
+	};
+
+	inline constexpr auto fieldLookups = [] {
+		std::array<FieldLookup, std::size(sections)> result{};
+		for (std::size_t s = 0; s < std::size(sections); s++) {
+			auto& lookup = result[s];
+			for (const auto field : sections[s].fields) {
+				lookup.fields[lookup.size] = { field, static_cast<std::uint16_t>(lookup.size) };
+				++lookup.size;
+			}
+			std::sort(lookup.fields.begin(), lookup.fields.begin() + lookup.size);
+		}
+		return result;
+	}();
+
+	// Keys of an RDSA entry
+	inline constexpr std::string_view regionSoundKeys[] = { "Sound", "Flags", "Chance" };
+
+	// Bit order matches RE::TESRegionDataSound::Sound::Flag
+	inline constexpr std::string_view regionSoundFlags[] = { "Pleasant", "Cloudy", "Rainy", "Snowy" };
+
+	// A "Rule" object replaces "Form" to target every form of the section that passes all of its filters
+	enum class RuleKey : std::uint8_t
+	{
+		kRule,
+		kKeywords,         // all of them
+		kExcludeKeywords,  // none of them
+		kPlugins,          // plugin that defines the form
+		kEditorID          // pattern, * and ? wildcards, case-insensitive
+	};
+
+	inline constexpr std::string_view ruleKeys[] = { "Rule", "Keywords", "Exclude Keywords", "Plugins", "EditorID" };
+
+	inline constexpr auto GetRuleKey(RuleKey a_key) -> std::string_view
+	{
+		return ruleKeys[static_cast<std::size_t>(a_key)];
+	}
+
+	// Sound descriptors created from configs, referenced from any field by their name like an EditorID
+	inline constexpr std::string_view descriptorSection = "Sound Descriptors";
+
+	enum class DescriptorKey : std::uint8_t
+	{
+		kName,
+		kCategory,
+		kOutputModel,
+		kFiles,             // paths relative to Data
+		kStaticAttenuation  // dB
+	};
+
+	inline constexpr std::string_view descriptorKeys[] = { "Name", "Category", "Output Model", "Files", "Static Attenuation" };
+
+	// Signature of the records Category and Output Model point to
+	inline constexpr std::string_view descriptorRecords[] = { "SNCT", "SOPM" };
+
+	// A list in place of a sound field's value is a pool, one member is drawn each time the sound plays.
+	// Members are written as the sound alone or as an object with these keys, weights default to 1.
+	enum class PoolKey : std::uint8_t
+	{
+		kSound,
+		kWeight
+	};
+
+	inline constexpr std::string_view poolKeys[] = { "Sound", "Weight" };
+
+	inline constexpr auto GetPoolKey(PoolKey a_key) -> std::string_view
+	{
+		return poolKeys[static_cast<std::size_t>(a_key)];
+	}
+
+	// Replaces every use of a sound, in every field of every section, with another sound
+	inline constexpr std::string_view replaceSection = "Replace";
+
+	enum class ReplaceKey : std::uint8_t
+	{
+		kSound,
+		kWith
+	};
+
+	inline constexpr std::string_view replaceKeys[] = { "Sound", "With" };
+
+	inline constexpr auto GetReplaceKey(ReplaceKey a_key) -> std::string_view
+	{
+		return replaceKeys[static_cast<std::size_t>(a_key)];
+	}
+
+	inline constexpr auto GetDescriptorKey(DescriptorKey a_key) -> std::string_view
+	{
+		return descriptorKeys[static_cast<std::size_t>(a_key)];
+	}
+
+	inline constexpr auto GetSection(Section a_section) -> const SectionInfo&
+	{
+		return sections[static_cast<std::size_t>(a_section)];
+	}
+
+	inline constexpr auto GetFieldName(Section a_section, std::uint16_t a_field) -> std::string_view
+	{
+		return GetSection(a_section).fields[a_field];
+	}
+
+	inline constexpr auto GetFieldRecord(Section a_section, std::uint16_t a_field) -> std::string_view
+	{
+		return GetSection(a_section).fieldRecords[a_field];
+	}
+
+	// Key of the field named a_name, kNoField for keys that aren't fields of the section
+	inline constexpr auto FindField(Section a_section, std::string_view a_name) -> std::uint16_t
+	{
+		return fieldLookups[static_cast<std::size_t>(a_section)].Find(a_name);
+	}
+
+	// Every field of every section is found under its own key
+	static_assert([] {
+		for (std::size_t s = 0; s < std::size(sections); s++) {
+			const auto& fields = sections[s].fields;
+			for (std::size_t f = 0; f < fields.size(); f++) {
+				if (FindField(static_cast<Section>(s), fields[f]) != f)
+					return false;
+			}
+		}
+		return true;
+	}());
+
+	// FNV-1a over every section and field name, compiled bundles are rejected when it changes
+	inline constexpr std::uint32_t hash = [] {
+		std::uint32_t result = 2166136261u;
+		const auto add = [&](std::string_view a_name) {
+			for (const char c : a_name)
+				result = (result ^ static_cast<std::uint8_t>(c)) * 16777619u;
+			result = (result ^ 0xFFu) * 16777619u;
+		};
+		for (const auto& section : sections) {
+			add(section.name);
+			for (const auto field : section.fields)
+				add(field);
+		}
+		for (const auto key : regionSoundKeys)
+			add(key);
+		for (const auto flag : regionSoundFlags)
+			add(flag);
+		for (const auto key : ruleKeys)
+			add(key);
+		add(descriptorSection);
+		for (const auto key : descriptorKeys)
+			add(key);
+		for (const auto key : poolKeys)
+			add(key);
+		add(replaceSection);
+		for (const auto key : replaceKeys)
+			add(key);
+		return result;
+	}();
+
+	inline constexpr auto configSuffix = "_SRD"sv;
+	inline constexpr auto bundleExtension = ".srdb"sv;
+
+	inline auto IsConfigFile(const std::filesystem::path& a_path) -> bool
+	{
+		const auto ext = a_path.extension().string();
+		return (ext == ".json" || ext == ".jsonc" || ext == ".yaml") && a_path.stem().string().ends_with(configSuffix);
+	}
+
+	inline auto IsBundleFile(const std::filesystem::path& a_path) -> bool
+	{
+		return a_path.extension().string() == bundleExtension && a_path.stem().string().ends_with(configSuffix);
+	}
+
+	// Plugin-specific configs are named after their plugin, e.g. Skyrim.esm_SRD.json
+	inline auto IsPluginConfig(const std::filesystem::path& a_path) -> bool
+	{
+		return a_path.stem().string().contains(".es");
+	}
+}
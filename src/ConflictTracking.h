@@ -0,0 +1,19 @@
+#pragma once
+
+// How much the apply step records about which config edited which field:
+//   kNone   - nothing, the bookkeeping compiles out of the apply functions
+//   kCounts - the number of field edits per section
+//   kFull   - every edit with its config, the conflict summary and Snapshot need this
+enum class ConflictTracking : std::uint8_t
+{
+	kNone,
+	kCounts,
+	kFull
+};
+
+// Builds configured with SRD_CONFLICT_TRACKING use that mode only, the other apply paths aren't compiled
+#ifdef SRD_CONFLICT_TRACKING
+inline constexpr std::optional<ConflictTracking> fixedConflictTracking = static_cast<ConflictTracking>(SRD_CONFLICT_TRACKING);
+#else
+inline constexpr std::optional<ConflictTracking> fixedConflictTracking = std::nullopt;
+#endif
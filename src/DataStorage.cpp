@@ -1,12 +1,42 @@
 #include "DataStorage.h"
 
+#include "ConfigSchema.h"
+#include "AllocationStats.h"
 #include "FormUtil.h"
-#include "tojson.hpp"
+#include "Settings.h"
+#include "Snapshot.h"
+#include "Trace.h"
 
+#include <execution>
+
+DataStorage::DataStorage() :
+	loader([this](std::string_view a_modname) { return IsModLoaded(a_modname); },
+		[this](ConfigLoader::Level a_level, const std::string& a_message) { Log(a_level, a_message); })
+{
+}
+
+void DataStorage::Log(ConfigLoader::Level a_level, const std::string& a_message)
+{
+	switch (a_level) {
+	case ConfigLoader::Level::kDebug:
+		logger::debug("{}", a_message);
+		break;
+	case ConfigLoader::Level::kInfo:
+		logger::info("{}", a_message);
+		break;
+	case ConfigLoader::Level::kWarning:
+		logger::warn("{}", a_message);
+		break;
+	case ConfigLoader::Level::kError:
+		logger::error("{}", a_message);
+		RE::DebugMessageBox(a_message.c_str());
+		break;
+	}
+}
 
 bool DataStorage::IsModLoaded(std::string_view a_modname)
 {
-	static const auto dataHandler = RE::TESDataHandler::GetSingleton();
+	const auto dataHandler = RE::TESDataHandler::GetSingleton();
 	constexpr std::uint8_t NOT_LOADED_IDX = 0xFF;
 
 	for (const auto file : dataHandler->files) {
@@ -29,656 +59,1522 @@ bool DataStorage::IsModLoaded(std::string_view a_modname)
 	return false;
 }
 
-void DataStorage::InsertConflictField(std::unordered_map<std::string, std::list<std::string>>& a_conflicts, std::string a_field)
+void DataStorage::MergeApplyBuffer(ApplyBuffer& a_buffer)
 {
-	if (a_conflicts.contains(a_field)) {
-		auto& conflictField = a_conflicts[a_field];
-		conflictField.emplace_back(currentFilename);
-	} else {
-		std::list<std::string> conflictField;
-		conflictField.emplace_back(currentFilename);
-		a_conflicts.insert({ a_field, conflictField });
+	for (const auto& conflict : a_buffer.conflicts) {
+		const auto [it, inserted] = lastEdits.try_emplace({ conflict.form, conflict.sound, conflict.field }, edits.size());
+		if (!inserted && edits[it->second].value == conflict.value) {
+			edits[it->second].config = conflict.config;
+			collapsedEdits++;
+			continue;
+		}
+		it->second = edits.size();
+		edits.push_back(conflict);
 	}
+
+	for (const auto& errorMessage : a_buffer.errors) {
+		logger::error("{}", errorMessage);
+		RE::DebugMessageBox(errorMessage.c_str());
+	}
+
+	a_buffer.conflicts.clear();
+	a_buffer.errors.clear();
 }
 
-void DataStorage::InsertConflictInformationRegions(RE::TESForm* a_region, RE::TESForm* a_sound, std::list<std::string> a_fields)
+void DataStorage::PublishSnapshot()
 {
-	if (!conflictMapRegions.contains(a_region)) {
-		std::unordered_map<RE::TESForm*, std::unordered_map<std::string, std::list<std::string>>> insertMap;
-		conflictMapRegions[a_region] = insertMap;
-	}
+	std::vector<Snapshot::Edit> snapshotEdits;
+	snapshotEdits.reserve(edits.size());
+	for (const auto& [form, sound, field, config, value] : edits)
+		snapshotEdits.emplace_back(form->GetFormID(), GetFormKey(createdForms, sound), field, config, value);
+
+	std::vector<std::string> files;
+	files.reserve(loader.configs.size());
+	for (const auto& config : loader.configs)
+		files.push_back(config.filename);
+
+	Snapshot::Publish(std::make_unique<Snapshot>(std::move(snapshotEdits), std::move(files), collapsedEdits));
+	edits = {};
+	lastEdits = {};
+	collapsedEdits = 0;
+}
 
-	if (!conflictMapRegions[a_region].contains(a_sound)) {
-		std::unordered_map<std::string, std::list<std::string>> insertMap;
-		conflictMapRegions[a_region][a_sound] = insertMap;
+void DataStorage::ReportDigest()
+{
+	const auto snapshot = Snapshot::Get();
+	if (!snapshot)
+		return;
+
+	logger::info("Final state digest {:016X} over {} fields", snapshot->GetDigest(), snapshot->GetFinalState().size());
+
+	if (!Settings::GetSingleton()->writeState)
+		return;
+	if (auto path = logger::log_directory()) {
+		*path /= std::format("{}.state.txt", Plugin::NAME);
+		std::ofstream file(*path, std::ios::binary | std::ios::trunc);
+		snapshot->WriteState(file);
+		if (file.good())
+			logger::info("Wrote final state to {}", path->string());
+		else
+			logger::warn("Failed to write final state to {}", path->string());
 	}
-	for (auto field : a_fields)
-		InsertConflictField(conflictMapRegions[a_region][a_sound], field);
 }
 
-void DataStorage::InsertConflictInformation(RE::TESForm* a_form, std::list<std::string> a_fields)
+void DataStorage::PrintConflicts()
 {
-	if (!conflictMap.contains(a_form)) {
-		std::unordered_map<std::string, std::list<std::string>> insertMap;
-		conflictMap[a_form] = insertMap;
+	logger::info("\nConflict summary:\n");
+	const auto snapshot = Snapshot::Get();
+	if (!snapshot || snapshot->GetEdits().empty()) {
+		logger::info("No conflicts found.");
+		return;
 	}
 
-	for (auto field : a_fields)
-		InsertConflictField(conflictMap[a_form], field);
+	const auto identifier = [](std::uint64_t a_key) {
+		if (a_key & Snapshot::kCreated)
+			return std::format("SRD sound {}", a_key & ~Snapshot::kCreated);
+		const auto form = RE::TESForm::LookupByID(static_cast<RE::FormID>(a_key));
+		return form ? FormUtil::GetIdentifierFromForm(form) : std::format("{:08X}", a_key);
+	};
+
+	// Edits are sorted by form, sound and field, so every run of equal keys is one field. Only fields left with more
+	// than one write once identical overrides collapse are conflicts, a_header runs before the first one printed.
+	std::size_t conflicts = 0;
+	const auto printFields = [&](std::span<const Snapshot::Edit> a_edits, std::string_view a_indent, auto&& a_header) {
+		for (auto it = a_edits.begin(); it != a_edits.end();) {
+			const auto begin = it;
+			while (it != a_edits.end() && it->field == begin->field)
+				++it;
+			if (it - begin < 2)
+				continue;
+
+			std::string filesString;
+			for (const auto& edit : std::span{ begin, it })
+				filesString += " -> " + snapshot->GetFile(edit);
+			a_header();
+			logger::info("{}{} {}", a_indent, begin->field, filesString);
+			conflicts++;
+		}
+	};
+
+	const auto edits = snapshot->GetEdits();
+	const auto splitBy = [&](auto a_project, auto a_callback) {
+		for (auto it = edits.begin(); it != edits.end();) {
+			const auto key = a_project(*it);
+			const auto begin = it;
+			while (it != edits.end() && a_project(*it) == key)
+				++it;
+			a_callback(std::span{ begin, it });
+		}
+	};
+
+	// Region sounds first, then every other form. Sound 0 sorts first, so a form's own fields lead its run
+	splitBy([](const Snapshot::Edit& a_edit) { return a_edit.form; }, [&](std::span<const Snapshot::Edit> a_form) {
+		if (!a_form.back().sound)
+			return;
+		bool formPrinted = false;
+		for (auto it = a_form.begin(); it != a_form.end();) {
+			const auto sound = it->sound;
+			const auto begin = it;
+			while (it != a_form.end() && it->sound == sound)
+				++it;
+			if (!sound)
+				continue;
+			bool soundPrinted = false;
+			printFields({ begin, it }, "        ", [&] {
+				if (!std::exchange(formPrinted, true))
+					logger::info("\n{}", identifier(a_form.front().form));
+				if (!std::exchange(soundPrinted, true))
+					logger::info("    {}", identifier(sound));
+			});
+		}
+	});
+
+	splitBy([](const Snapshot::Edit& a_edit) { return a_edit.form; }, [&](std::span<const Snapshot::Edit> a_form) {
+		const auto end = std::ranges::find_if(a_form, [](const Snapshot::Edit& a_edit) { return a_edit.sound != 0; });
+		bool printed = false;
+		printFields({ a_form.begin(), end }, "    ", [&] {
+			if (!std::exchange(printed, true))
+				logger::info("\n{}", identifier(a_form.front().form));
+		});
+	});
+
+	if (!conflicts)
+		logger::info("No conflicts found.");
+	if (const auto collapsed = snapshot->GetCollapsedCount())
+		logger::info("\n{} field edits kept, {} identical overrides collapsed", edits.size(), collapsed);
 }
 
-std::pair<std::set<std::string>, std::set<std::string>>
-DataStorage::ScanConfigDirectory()
+void DataStorage::LoadConfigs()
 {
-	std::set<std::string> generalConfigs;
-	std::set<std::string> pluginConfigs;
+	using clock = std::chrono::steady_clock;
 
-	constexpr auto folder = R"(Data\)"sv;
+	AllocationStats::Reset();
+	Trace::Reset();
 
-	logger::info("\nScanning {} for configs ending with _SRD.json/.jsonc/.yaml...", folder);
+	std::vector<std::string> plugins;
+	for (const auto file : RE::TESDataHandler::GetSingleton()->files) {
+		if (file)
+			plugins.emplace_back(file->GetFilename());
+	}
 
-	for (const auto& entry : std::filesystem::directory_iterator(folder)) {
-		if (!entry.exists() || entry.path().empty()) {
-			continue;
+	auto begin = clock::now();
+	auto [generalConfigs, pluginConfigs] = [&] {
+		AllocationStats::Scope scope(AllocationStats::Phase::kScan);
+
+		// Only the archive named after each loaded plugin, the same ones the game mounts for it
+		std::vector<std::filesystem::path> archives;
+		for (const auto& plugin : plugins) {
+			auto archive = std::filesystem::path(R"(Data\)") / plugin;
+			archive.replace_extension(".bsa");
+			if (std::filesystem::exists(archive))
+				archives.push_back(std::move(archive));
 		}
+		return loader.ScanConfigDirectory(R"(Data\)", archives);
+	}();
+	auto end = clock::now();
 
-		const auto ext = entry.path().extension().string();
-		if (ext != ".json" && ext != ".jsonc" && ext != ".yaml") {
-			continue;
-		}
+	logger::info("Scanned configs in {} ms\n",
+				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
 
-		const auto stem = entry.path().stem().string(); // filename without extension
-		if (!stem.ends_with("_SRD")) {
-			continue;
-		}
+	if (generalConfigs.empty() && pluginConfigs.empty()) {
+		logger::warn("No configs found in Data\\ ending with _SRD.json/.jsonc/.yaml/.srdb");
+		return;
+	}
 
-		const auto path = entry.path().string();
+	begin = clock::now();
+	{
+		SRD_TRACE_SCOPE("Parse");
+		AllocationStats::Scope scope(AllocationStats::Phase::kParse);
+		auto pluginMap = loader.MatchPluginConfigs(pluginConfigs, plugins);
+		loader.ParseAllConfigs(pluginMap, generalConfigs);
+	}
+	end = clock::now();
 
-		// Old logic: plugin configs contain ".es"
-		if (stem.contains(".es")) {
-			logger::info("Found plugin-specific config: {}", path);
-			pluginConfigs.insert(path);
-		} else {
-			logger::info("Found general config: {}", path);
-			generalConfigs.insert(path);
-		}
+	const auto& prefilterStats = loader.prefilterStats;
+	using ms = std::chrono::duration<double, std::milli>;
+	const auto prefilterMs = std::chrono::duration_cast<ms>(prefilterStats.prefilterTime).count();
+	if (prefilterStats.skippedConfigs && prefilterStats.parsedBytes) {
+		// Saved time is estimated from the parse throughput of the configs that were fully parsed
+		const auto parseMs = std::chrono::duration_cast<ms>(prefilterStats.parseTime).count();
+		const auto savedMs = parseMs * prefilterStats.skippedBytes / prefilterStats.parsedBytes;
+		logger::info("Requirements pre-filter skipped {} configs ({} bytes), saving ~{:.1f} ms of parsing in {:.1f} ms",
+			prefilterStats.skippedConfigs, prefilterStats.skippedBytes, savedMs, prefilterMs);
+	} else if (prefilterStats.skippedConfigs) {
+		logger::info("Requirements pre-filter skipped {} configs ({} bytes) in {:.1f} ms",
+			prefilterStats.skippedConfigs, prefilterStats.skippedBytes, prefilterMs);
 	}
 
-	return { generalConfigs, pluginConfigs };
-}
+	logger::info("Parsed configs in {} ms",
+				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
 
-std::map<std::string, std::set<std::string>>
-DataStorage::MatchPluginConfigs(const std::set<std::string>& pluginConfigs)
-{
-	std::map<std::string, std::set<std::string>> result;
+	begin = clock::now();
+	{
+		SRD_TRACE_SCOPE("Apply");
+		ApplyConfigs();
+	}
+	end = clock::now();
 
-	auto* dataHandler = RE::TESDataHandler::GetSingleton();
+	// The rest is reported once the last slice is done
+	if (sliced) {
+		logger::info("Resolved configs in {} ms, applying the edits in the background",
+					 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
+		return;
+	}
 
-	logger::info("Matching plugin-specific configs to loaded plugins...");
-	for (auto* file : dataHandler->files) {
-		if (!file) {
-			continue;
-		}
+	logger::info("Applied configs in {} ms",
+				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
 
-		const auto pluginName = file->GetFilename();
+	ReportLoad();
+}
 
-		if (!IsModLoaded(pluginName)) {
-			logger::warn("Plugin {} is not loaded, skipping configs", pluginName);
-			continue;
-		}
+void DataStorage::ReportLoad()
+{
+	using clock = std::chrono::steady_clock;
 
-		std::set<std::string> matched;
+	const auto begin = clock::now();
+	if (conflictTracking == ConflictTracking::kFull) {
+		SRD_TRACE_SCOPE("Conflicts");
+		AllocationStats::Scope scope(AllocationStats::Phase::kConflicts);
+		PrintConflicts();
+		ReportDigest();
+	} else {
+		logger::info("\nConflict summary is off, set [Conflicts] Tracking = full to print it");
+	}
+	const auto end = clock::now();
 
-		for (const auto& configPath : pluginConfigs) {
-			const auto configName = std::filesystem::path(configPath).filename().string();
+	logger::info("Printed conflicts in {} ms",
+				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
 
-			// Old logic: config filename starts with plugin name
-			if (configName.rfind(pluginName, 0) == 0) {
-				logger::info("Adding config {} for plugin {}", configName, pluginName);
-				matched.insert(configPath);
-			}
-		}
+	AllocationStats::Report();
 
-		if (!matched.empty()) {
-			result.emplace(pluginName, std::move(matched));
+	if constexpr (Trace::enabled) {
+		if (auto path = logger::log_directory()) {
+			*path /= std::format("{}.trace.json", Plugin::NAME);
+			if (Trace::Dump(*path))
+				logger::info("Wrote load trace to {}", path->string());
 		}
 	}
-
-	return result;
 }
 
-void DataStorage::ParseAllConfigs(
-	const std::map<std::string, std::set<std::string>>& pluginMap,
-	const std::set<std::string>& generalConfigs)
+template <typename T>
+bool DataStorage::LookupFormString(ApplyContext& a_ctx, T** a_type, const Pack::Field& a_field, bool a_error)
 {
-	logger::info("\nParsing configs...");
+	if (a_field.value == Pack::kNone) {
+		*a_type = nullptr;
+		return true;
+	}
 
-	for (const auto& [plugin, configs] : pluginMap) {
-		logger::info("Parsing {} configs for plugin {}", configs.size(), plugin);
-		ParseConfigs(configs);
+	const bool pool = a_field.presence & Pack::Field::kPool;
+	const auto form = a_ctx.GetValue(a_field);
+	if (auto ret = form ? form->As<T>() : nullptr) {
+		*a_type = ret;
+		return true;
 	}
 
-	if (!generalConfigs.empty()) {
-		logger::info("Parsing {} general configs", generalConfigs.size());
-		ParseConfigs(generalConfigs);
+	if (a_error) {
+		std::string name = typeid(T).name();
+		std::string errorMessage = pool ?
+		                               std::format("	No sound of a {} pool exists in {}, this entry may be incomplete", name, a_ctx.filename) :
+		                               std::format("	Form {} of {} does not exist in {}, this entry may be incomplete", a_ctx.pack.FormatIdentifier(a_field.value), name, a_ctx.filename);
+		a_ctx.buffer.errors.emplace_back(std::move(errorMessage));
 	}
+	return false;
 }
 
-void DataStorage::PrintConflicts()
+template <typename T>
+T* DataStorage::LookupForm(ApplyContext& a_ctx, const Pack::Record& a_record)
 {
-	logger::info("\nConflict summary:\n");
-	if(conflictMapRegions.empty() && conflictMap.empty()) {
-		logger::info("No conflicts found.");
-		return;
+	const auto form = a_ctx.forms[a_record.form];
+	T* ret = form ? form->As<T>() : nullptr;
+	if (!ret) {
+		std::string name = typeid(T).name();
+		std::string errorMessage = std::format("	Form {} of {} does not exist in {}, skipping entry", a_ctx.pack.FormatIdentifier(a_record.form), name, a_ctx.filename);
+		logger::warn("{}", errorMessage);
 	}
+	return ret;
+}
 
-	for (auto& [region, soundMap] : conflictMapRegions) {
-		if (soundMap.empty()) {
-			continue;
-		}
+template <typename T>
+RE::TESForm* DataStorage::ResolveRecord(ApplyContext& a_ctx, const Pack::Record& a_record)
+{
+	return LookupForm<T>(a_ctx, a_record);
+}
 
-		logger::info("\n{}", FormUtil::GetIdentifierFromForm(region));
+stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> DataStorage::GetSoundFlags(std::uint8_t a_flags)
+{
+	// Same order as Schema::regionSoundFlags
+	static constexpr RE::TESRegionDataSound::Sound::Flag soundFlags[] = {
+		RE::TESRegionDataSound::Sound::Flag::kPleasant,
+		RE::TESRegionDataSound::Sound::Flag::kCloudy,
+		RE::TESRegionDataSound::Sound::Flag::kRainy,
+		RE::TESRegionDataSound::Sound::Flag::kSnowy
+	};
 
-		for (auto& [sound, conflictInfo] : soundMap) {
-			if (conflictInfo.empty()) {
-				continue;
-			}
+	stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> flags;
+	for (std::size_t i = 0; i < std::size(soundFlags); i++) {
+		if (a_flags & (1 << i))
+			flags.set(soundFlags[i]);
+	}
+	if (!a_flags)
+		flags.set(RE::TESRegionDataSound::Sound::Flag::kNone);
+	return flags;
+}
 
-			logger::info("    {}", FormUtil::GetIdentifierFromForm(sound));
+RE::TESRegionDataSound::Sound* GetOrCreateSound(bool& aout_created, RE::BSTArray<RE::TESRegionDataSound::Sound*>& a_sounds, RE::BGSSoundDescriptorForm* a_soundDescriptor)
+{
+	for (auto sound : a_sounds) {
+		if (sound->sound == a_soundDescriptor) {
+			aout_created = false;
+			return sound;
+		}
+	}
+	aout_created = true;
+
+	// New entries are owned by the region, they are not part of the apply allocation budget
+	AllocationStats::Scope scope(AllocationStats::Phase::kNone);
+	auto soundRecord = new RE::TESRegionDataSound::Sound;
+	a_sounds.emplace_back(soundRecord);
+	return soundRecord;
+}
 
-			for (auto& [field, files] : conflictInfo) {
-				std::string filesString;
-				for (auto& file : files) {
-					filesString += " -> " + file;
+template <ConflictTracking Mode>
+void DataStorage::ApplyRegion(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	const auto dataHandler = RE::TESDataHandler::GetSingleton();
+
+	auto regn = a_form->As<RE::TESRegion>();
+	RE::TESRegionDataSound* regionDataEntry = nullptr;
+	for (auto entry : regn->dataList->regionDataList) {
+		if (entry->GetType() == RE::TESRegionData::Type::kSound) {
+			const auto regionDataManager = dataHandler->GetRegionDataManager();
+			if (regionDataManager)
+				regionDataEntry = regionDataManager->AsRegionDataSound(entry);
+			if (regionDataEntry)
+				break;
+		}
+	}
+	if (regionDataEntry) {
+		for (const auto& rdsa : a_ctx.pack.GetFields(a_record)) {
+			RE::BGSSoundDescriptorForm* sound = nullptr;
+			if (LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &sound, rdsa)) {
+				bool created;
+				auto soundRecord = GetOrCreateSound(created, regionDataEntry->sounds, sound);
+				soundRecord->sound = sound;
+
+				if (rdsa.presence & Pack::Field::kFlags) {
+					soundRecord->flags = GetSoundFlags(rdsa.flags);
+					a_ctx.InsertConflictInformationRegions(regn, sound, "Flags"sv, soundRecord->flags.underlying());
+				} else if (created) {
+					soundRecord->flags = GetSoundFlags(0b1111);
+					a_ctx.InsertConflictInformationRegions(regn, sound, "Flags"sv, soundRecord->flags.underlying());
+				}
+				if (rdsa.presence & Pack::Field::kChance) {
+					soundRecord->chance = rdsa.chance;
+					a_ctx.InsertConflictInformationRegions(regn, sound, "Chance"sv, std::bit_cast<std::uint32_t>(soundRecord->chance));
+				} else if (created) {
+					soundRecord->chance = 0.05f;
+					a_ctx.InsertConflictInformationRegions(regn, sound, "Chance"sv, std::bit_cast<std::uint32_t>(soundRecord->chance));
 				}
-				logger::info("        {} {}", field, filesString);
 			}
 		}
+	} else {
+		std::string errorMessage = std::format("RDSA entry does not exist in {}", FormUtil::GetIdentifierFromForm(regn));
+		a_ctx.buffer.errors.emplace_back(std::format("{}\n{}", a_ctx.filename, errorMessage));
 	}
+}
 
-	for (auto& [form, conflictInfo] : conflictMap) {
-		if (conflictInfo.empty()) {
-			continue;
+template <ConflictTracking Mode>
+void DataStorage::ApplyWeapon(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::WeaponField;
+
+	auto weap = a_form->As<RE::TESObjectWEAP>();
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kPickUp:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->pickupSound, field);
+			break;
+		case Field::kPutDown:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->putdownSound, field);
+			break;
+		case Field::kImpactDataSet:
+			changed = LookupFormString<RE::BGSImpactDataSet>(a_ctx, &weap->impactDataSet, field);
+			break;
+		case Field::kAttack:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->attackSound, field);
+			break;
+		case Field::kAttack2D:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->attackSound2D, field);
+			break;
+		case Field::kAttackLoop:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->attackLoopSound, field);
+			break;
+		case Field::kAttackFail:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->attackFailSound, field);
+			break;
+		case Field::kIdle:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->idleSound, field);
+			break;
+		case Field::kEquip:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->equipSound, field);
+			break;
+		case Field::kUnequip:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &weap->unequipSound, field);
+			break;
 		}
+		if (changed)
+			a_ctx.InsertConflictInformation(weap, a_record.section, field);
+	}
+}
+
+template <ConflictTracking Mode>
+void DataStorage::ApplyMagicEffect(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	auto mgef = a_form->As<RE::EffectSetting>();
+	RE::BGSSoundDescriptorForm* slots[6];
+	bool useSlots[6] = { false, false, false, false, false, false };
+
+	// Field keys follow RE::MagicSystem::SoundID
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		const auto i = field.key;
+		useSlots[i] = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &slots[i], field);
+		if (useSlots[i])
+			a_ctx.InsertConflictInformation(mgef, a_record.section, field);
+	}
 
-		logger::info("\n{}", FormUtil::GetIdentifierFromForm(form));
+	for (auto& sndd : mgef->effectSounds) {
+		int i = (int)sndd.id;
+		if (useSlots[i]) {
+			sndd.sound = slots[i];
+			sndd.pad04 = (bool)slots[i];
+			useSlots[i] = false;
+		}
+	}
 
-		for (auto& [field, files] : conflictInfo) {
-			std::string filesString;
-			for (auto& file : files) {
-				filesString += " -> " + file;
-			}
-			logger::info("    {} {}", field, filesString);
+	for (int i = 0; i < 6; i++) {
+		if (useSlots[i]) {
+			RE::EffectSetting::SoundPair soundPair;
+			soundPair.id = (RE::MagicSystem::SoundID)i;
+			soundPair.sound = slots[i];
+			soundPair.pad04 = (bool)slots[i];
+			mgef->effectSounds.emplace_back(soundPair);
 		}
 	}
 }
 
-void DataStorage::LoadConfigs()
+template <ConflictTracking Mode>
+void DataStorage::ApplyArmorAddon(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
 {
-	using clock = std::chrono::steady_clock;
-
-	auto begin = clock::now();
-	auto [generalConfigs, pluginConfigs] = ScanConfigDirectory();
-	auto end = clock::now();
+	auto arma = a_form->As<RE::TESObjectARMA>();
 
-	logger::info("Scanned configs in {} ms\n",
-				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		if (LookupFormString<RE::BGSFootstepSet>(a_ctx, &arma->footstepSet, field))
+			a_ctx.InsertConflictInformation(arma, a_record.section, field);
+	}
+}
 
-	if (generalConfigs.empty() && pluginConfigs.empty()) {
-		logger::warn("No configs found in Data\\ ending with _SRD.json/.jsonc/.yaml");
-		return;
+// Armors, misc. items and soul gems only carry pick up and put down sounds
+template <ConflictTracking Mode>
+void DataStorage::ApplyPickUpPutDown(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::PickUpPutDownField;
+
+	auto sounds = a_form->As<RE::BGSPickupPutdownSounds>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kPickUp:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &sounds->pickupSound, field);
+			break;
+		case Field::kPutDown:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &sounds->putdownSound, field);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(a_form, a_record.section, field);
 	}
+}
 
-	begin = clock::now();
-	auto pluginMap = MatchPluginConfigs(pluginConfigs);
-	ParseAllConfigs(pluginMap, generalConfigs);
-	end = clock::now();
+template <ConflictTracking Mode>
+void DataStorage::ApplyProjectile(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::ProjectileField;
+
+	auto proj = a_form->As<RE::BGSProjectile>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kActive:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &proj->data.activeSoundLoop, field);
+			break;
+		case Field::kCountdown:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &proj->data.countdownSound, field);
+			break;
+		case Field::kDeactivate:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &proj->data.deactivateSound, field);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(proj, a_record.section, field);
+	}
+}
 
-	logger::info("Parsed configs in {} ms",
-				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
+template <ConflictTracking Mode>
+void DataStorage::ApplyExplosion(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::ExplosionField;
+
+	auto expl = a_form->As<RE::BGSExplosion>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kInterior:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &expl->data.sound1, field);
+			break;
+		case Field::kExterior:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &expl->data.sound2, field);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(expl, a_record.section, field);
+	}
+}
 
-	begin = clock::now();
-	PrintConflicts();
-	end = clock::now();
+template <ConflictTracking Mode>
+void DataStorage::ApplyEffectShader(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	auto efsh = a_form->As<RE::TESEffectShader>();
 
-	logger::info("Printed conflicts in {} ms",
-				 std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		if (LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &efsh->data.ambientSound, field))
+			a_ctx.InsertConflictInformation(efsh, a_record.section, field);
+	}
 }
 
-void DataStorage::ParseConfigs(const std::set<std::string>& a_configs)
+template <ConflictTracking Mode>
+void DataStorage::ApplyIngestible(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
 {
-	for (const auto& configPath : a_configs) {
-
-		const std::filesystem::path path(configPath);
-		const std::string filename = path.filename().string();
-		const std::string extension = path.extension().string();
+	auto alch = a_form->As<RE::AlchemyItem>();
 
-		logger::info("Parsing {}", filename);
-		currentFilename = filename;
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		if (LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &alch->data.consumptionSound, field))
+			a_ctx.InsertConflictInformation(alch, a_record.section, field);
+	}
+}
 
-		try {
-			std::ifstream file(configPath);
+template <ConflictTracking Mode>
+void DataStorage::ApplyAcousticSpace(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::AcousticSpaceField;
+
+	auto aspc = a_form->As<RE::BGSAcousticSpace>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kAmbient:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &aspc->loopingSound, field);
+			break;
+		case Field::kReverb:
+			changed = LookupFormString<RE::BGSReverbParameters>(a_ctx, &aspc->reverbType, field);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(aspc, a_record.section, field);
+	}
+}
 
-			if (!file.good()) {
-				const std::string errorMessage =
-				std::format("Failed to parse {}\nBad file stream", filename);
-				logger::error("{}", errorMessage);
-				RE::DebugMessageBox(errorMessage.c_str());
-				continue;
-			}
+// Returns the extra data of a cell, created when the cell has none yet
+template <class T>
+T* GetOrCreateCellExtra(RE::TESObjectCELL* a_cell)
+{
+	if (auto extra = a_cell->extraList.GetByType<T>())
+		return extra;
+
+	// Owned by the cell, like new region sounds
+	AllocationStats::Scope scope(AllocationStats::Phase::kNone);
+	auto extra = RE::BSExtraData::Create<T>(sizeof(T), T::VTABLE[0].address());
+	a_cell->extraList.Add(extra);
+	return extra;
+}
 
-			json data;
-
-			// YAML → JSON conversion
-			if (extension == ".yaml") {
-				try {
-					logger::info("Converting {} to JSON object", filename);
-					data = tojson::loadyaml(configPath);
-				} catch (const std::exception& exc) {
-					const std::string errorMessage =
-					std::format("Failed to convert {} to JSON object\n{}", filename, exc.what());
-					logger::error("{}", errorMessage);
-					RE::DebugMessageBox(errorMessage.c_str());
-					continue;
-				}
+template <ConflictTracking Mode>
+void DataStorage::ApplyCell(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::CellField;
+
+	auto cell = a_form->As<RE::TESObjectCELL>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kAcousticSpace:
+			{
+				RE::BGSAcousticSpace* space = nullptr;
+				if ((changed = LookupFormString<RE::BGSAcousticSpace>(a_ctx, &space, field)))
+					GetOrCreateCellExtra<RE::ExtraCellAcousticSpace>(cell)->space = space;
 			}
-			// JSON / JSONC
-			else {
-				try {
-					data = json::parse(file, nullptr, true, true);
-				} catch (const std::exception& exc) {
-					const std::string errorMessage =
-					std::format("Failed to parse {}\n{}", filename, exc.what());
-					logger::error("{}", errorMessage);
-					RE::DebugMessageBox(errorMessage.c_str());
-					continue;
-				}
+			break;
+		case Field::kMusic:
+			{
+				RE::BGSMusicType* music = nullptr;
+				if ((changed = LookupFormString<RE::BGSMusicType>(a_ctx, &music, field)))
+					GetOrCreateCellExtra<RE::ExtraCellMusicType>(cell)->type = music;
 			}
-			// Process the parsed config
-			RunConfig(data);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(cell, a_record.section, field);
+	}
+}
+
+template <ConflictTracking Mode>
+void DataStorage::ApplyActivator(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::ActivatorField;
+
+	auto acti = a_form->As<RE::TESObjectACTI>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kLoop:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &acti->soundLoop, field);
+			break;
+		case Field::kActivate:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &acti->soundActivate, field);
+			break;
 		}
-		catch (const std::exception& exc) {
-			const std::string errorMessage =
-			std::format("Failed to parse {}\n{}", filename, exc.what());
-			logger::error("{}", errorMessage);
-			RE::DebugMessageBox(errorMessage.c_str());
+		if (changed)
+			a_ctx.InsertConflictInformation(acti, a_record.section, field);
+	}
+}
+
+template <ConflictTracking Mode>
+void DataStorage::ApplyDoor(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using Field = Schema::DoorField;
+
+	auto door = a_form->As<RE::TESObjectDOOR>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kOpen:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &door->openSound, field);
+			break;
+		case Field::kClose:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &door->closeSound, field);
+			break;
+		case Field::kLoop:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &door->loopSound, field);
+			break;
 		}
+		if (changed)
+			a_ctx.InsertConflictInformation(door, a_record.section, field);
 	}
 }
 
-template <typename T>
-T* LookupFormID(std::string a_identifier)
+template <ConflictTracking Mode>
+void DataStorage::ApplyContainer(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
 {
-	auto form = FormUtil::GetFormFromIdentifier(a_identifier);
-	if (form)
-		return form->As<T>();
-	return nullptr;
+	using Field = Schema::ContainerField;
+
+	auto cont = a_form->As<RE::TESObjectCONT>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		bool changed = false;
+		switch (static_cast<Field>(field.key)) {
+		case Field::kOpen:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &cont->openSound, field);
+			break;
+		case Field::kClose:
+			changed = LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &cont->closeSound, field);
+			break;
+		}
+		if (changed)
+			a_ctx.InsertConflictInformation(cont, a_record.section, field);
+	}
 }
 
-template <typename T>
-T* DataStorage::LookupEditorID(std::string a_editorID)
+template <ConflictTracking Mode>
+void DataStorage::ApplyWater(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
 {
-	auto form = RE::TESForm::LookupByEditorID(a_editorID);
-	if (form)
-		return form->As<T>();
-	return nullptr;
+	auto watr = a_form->As<RE::TESWaterForm>();
+
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		if (LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &watr->waterSound, field))
+			a_ctx.InsertConflictInformation(watr, a_record.section, field);
+	}
 }
 
-template <typename T>
-bool DataStorage::LookupFormString(T** a_type, json& a_record, std::string a_key, bool a_error)
-{
-	if (a_record.contains(a_key)) {
-		if (!a_record[a_key].is_null()) {
-			std::string formString = a_record[a_key];
-			T* ret;
-			if (formString.contains(".es") && formString.contains("|")) {
-				ret = LookupFormID<T>(formString);
-			} else {
-				ret = LookupEditorID<T>(formString);
+template <ConflictTracking Mode>
+void DataStorage::ApplyWeather(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record)
+{
+	using WeatherSound = RE::TESWeather::WeatherSound;
+	using SoundType = decltype(WeatherSound::type);
+
+	auto wthr = a_form->As<RE::TESWeather>();
+
+	// Field keys follow the weather sound types
+	for (const auto& field : a_ctx.pack.GetFields(a_record)) {
+		const auto type = static_cast<SoundType>(field.key);
+		RE::BGSSoundDescriptorForm* sound = nullptr;
+		if (!LookupFormString<RE::BGSSoundDescriptorForm>(a_ctx, &sound, field))
+			continue;
+
+		if (!sound) {
+			// Compacted in place, entries and list nodes both live on the game's heap and go back to it
+			const auto removed = [&](const WeatherSound* a_entry) { return a_entry && a_entry->type == type; };
+			while (!wthr->sounds.empty() && removed(wthr->sounds.front())) {
+				delete wthr->sounds.front();
+				wthr->sounds.pop_front();
 			}
-			if (ret) {
-				*a_type = ret;
-				return true;
-			} else {
-				if (a_error) {
-					std::string name = typeid(T).name();
-					std::string errorMessage = std::format("	Form {} of {} does not exist in {}, this entry may be incomplete", formString, name, currentFilename);
-					logger::error("{}", errorMessage);
-					RE::DebugMessageBox(errorMessage.c_str());
+			for (auto it = wthr->sounds.begin(); it != wthr->sounds.end();) {
+				const auto next = std::next(it);
+				if (next == wthr->sounds.end())
+					break;
+				if (removed(*next)) {
+					delete *next;
+					wthr->sounds.erase_after(it);
+				} else {
+					it = next;
 				}
-				return false;
 			}
+			a_ctx.InsertConflictInformation(wthr, a_record.section, field);
+			continue;
+		}
+
+		// Weather sounds are stored by form ID, which pool proxies and config sound descriptors don't have
+		if (!sound->GetFormID()) {
+			a_ctx.buffer.errors.emplace_back(std::format("	{} of a weather in {} is a sound pool or a config sound descriptor, weathers only take sounds of plugins, skipping it",
+				Schema::GetFieldName(a_record.section, field.key), a_ctx.filename));
+			continue;
+		}
+
+		const auto it = std::find_if(wthr->sounds.begin(), wthr->sounds.end(), [&](const WeatherSound* a_entry) { return a_entry && a_entry->sound == sound->GetFormID(); });
+		if (it == wthr->sounds.end()) {
+			// New entries are owned by the weather, they are not part of the apply allocation budget
+			AllocationStats::Scope scope(AllocationStats::Phase::kNone);
+			wthr->sounds.push_front(new WeatherSound{ sound->GetFormID(), type });
 		} else {
-			*a_type = nullptr;
-			return true;
+			(*it)->type = type;
 		}
+		a_ctx.InsertConflictInformationRegions(wthr, sound, "Type"sv, static_cast<std::uint32_t>(type));
 	}
-	return false;
 }
 
-template <typename T>
-T* DataStorage::LookupForm(json& a_record)
-{
-	try {
-		T* ret = nullptr;
-		LookupFormString<T>(&ret, a_record, "Form", false);
-		if (!ret) {
-			std::string identifier = a_record["Form"];
-			std::string name = typeid(T).name();
-			std::string errorMessage = std::format("	Form {} of {} does not exist in {}, skipping entry", identifier, name, currentFilename);
-			logger::warn("{}", errorMessage);
-		}
-		return ret;
-	} catch (const std::exception& exc) {
-		std::string errorMessage = std::format("	Failed to parse entry in {}\n{}", currentFilename, exc.what());
-		logger::error("{}", errorMessage);
-		RE::DebugMessageBox(errorMessage.c_str());
+const DataStorage::Section DataStorage::sections[] = {
+	{ &DataStorage::ResolveRecord<RE::TESRegion>, &RuleIndex::Match<RE::TESRegion> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectWEAP>, &RuleIndex::Match<RE::TESObjectWEAP> },
+	{ &DataStorage::ResolveRecord<RE::EffectSetting>, &RuleIndex::Match<RE::EffectSetting> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectARMA>, &RuleIndex::Match<RE::TESObjectARMA> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectARMO>, &RuleIndex::Match<RE::TESObjectARMO> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectMISC>, &RuleIndex::Match<RE::TESObjectMISC> },
+	{ &DataStorage::ResolveRecord<RE::TESSoulGem>, &RuleIndex::Match<RE::TESSoulGem> },
+	{ &DataStorage::ResolveRecord<RE::BGSProjectile>, &RuleIndex::Match<RE::BGSProjectile> },
+	{ &DataStorage::ResolveRecord<RE::BGSExplosion>, &RuleIndex::Match<RE::BGSExplosion> },
+	{ &DataStorage::ResolveRecord<RE::TESEffectShader>, &RuleIndex::Match<RE::TESEffectShader> },
+	{ &DataStorage::ResolveRecord<RE::AlchemyItem>, &RuleIndex::Match<RE::AlchemyItem> },
+	{ &DataStorage::ResolveRecord<RE::BGSAcousticSpace>, &RuleIndex::Match<RE::BGSAcousticSpace> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectCELL>, &RuleIndex::Match<RE::TESObjectCELL> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectACTI>, &RuleIndex::Match<RE::TESObjectACTI> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectDOOR>, &RuleIndex::Match<RE::TESObjectDOOR> },
+	{ &DataStorage::ResolveRecord<RE::TESObjectCONT>, &RuleIndex::Match<RE::TESObjectCONT> },
+	{ &DataStorage::ResolveRecord<RE::TESWaterForm>, &RuleIndex::Match<RE::TESWaterForm> },
+	{ &DataStorage::ResolveRecord<RE::TESWeather>, &RuleIndex::Match<RE::TESWeather> },
+};
+
+template <ConflictTracking Mode>
+const DataStorage::ApplyFunc<Mode> DataStorage::applyFunctions[] = {
+	&DataStorage::ApplyRegion<Mode>,
+	&DataStorage::ApplyWeapon<Mode>,
+	&DataStorage::ApplyMagicEffect<Mode>,
+	&DataStorage::ApplyArmorAddon<Mode>,
+	&DataStorage::ApplyPickUpPutDown<Mode>,
+	&DataStorage::ApplyPickUpPutDown<Mode>,
+	&DataStorage::ApplyPickUpPutDown<Mode>,
+	&DataStorage::ApplyProjectile<Mode>,
+	&DataStorage::ApplyExplosion<Mode>,
+	&DataStorage::ApplyEffectShader<Mode>,
+	&DataStorage::ApplyIngestible<Mode>,
+	&DataStorage::ApplyAcousticSpace<Mode>,
+	&DataStorage::ApplyCell<Mode>,
+	&DataStorage::ApplyActivator<Mode>,
+	&DataStorage::ApplyDoor<Mode>,
+	&DataStorage::ApplyContainer<Mode>,
+	&DataStorage::ApplyWater<Mode>,
+	&DataStorage::ApplyWeather<Mode>,
+};
+
+void DataStorage::BuildMergeTable()
+{
+	FormUtil::ClearMergedForms();
+	if (!g_mergeMapperInterface)
+		return;
+
+	SRD_TRACE_SCOPE("Merge table");
+	AllocationStats::Scope scope(AllocationStats::Phase::kResolve);
+
+	std::size_t identifiers = 0;
+	const auto add = [&](const Pack::View& a_pack, std::uint32_t a_identifier) {
+		if (a_identifier == Pack::kNone)
+			return;
+		const auto& identifier = a_pack.identifiers[a_identifier];
+		if (identifier.IsEditorID())
+			return;
+		identifiers++;
+		FormUtil::AddMergedForm(a_pack.GetString(identifier.plugin), identifier.value);
+	};
+
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		for (const auto& replacement : pack.GetReplacements(pack.configs[config.index])) {
+			add(pack, replacement.sound);
+			add(pack, replacement.with);
+		}
+		for (const auto& record : pack.GetRecords(pack.configs[config.index])) {
+			if (record.IsRule()) {
+				const auto& rule = pack.GetRule(record);
+				for (const auto keyword : pack.GetKeywords(rule))
+					add(pack, keyword);
+				for (const auto keyword : pack.GetExcludedKeywords(rule))
+					add(pack, keyword);
+			} else {
+				add(pack, record.form);
+			}
+			for (const auto& field : pack.GetFields(record)) {
+				if (field.presence & Pack::Field::kPool) {
+					for (const auto& member : pack.GetMembers(pack.pools[field.value]))
+						add(pack, member.sound);
+				} else {
+					add(pack, field.value);
+				}
+			}
+		}
 	}
-	return nullptr;
+
+	logger::info("MergeMapper: {} FormID identifiers, {} distinct pairs translated", identifiers, FormUtil::GetMergedFormCount());
 }
 
-std::list<std::string> split(const std::string s, char delim)
+void DataStorage::CreateSoundDescriptors(ResolvedForms& a_resolvedForms)
 {
-	std::list<std::string> result;
-	std::stringstream ss(s);
-	std::string item;
-	while (std::getline(ss, item, delim)) {
-		result.push_back(item);
+	SRD_TRACE_SCOPE("Sound descriptors");
+
+	// Keys start over with every load, descriptors kept from an earlier load get theirs again in the same order
+	createdForms.clear();
+	soundDescriptors.Create(loader.configs, [&](const Pack::View& a_pack, std::uint32_t a_identifier) {
+		return a_resolvedForms.at(&a_pack)[a_identifier];
+	});
+	if (soundDescriptors.IsEmpty())
+		return;
+
+	// Keyed in config order, so the keys of a load don't depend on how the descriptors are stored
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		for (const auto& descriptor : pack.GetDescriptors(pack.configs[config.index])) {
+			if (const auto form = soundDescriptors.Find(pack.GetString(descriptor.name)))
+				createdForms.try_emplace(form, static_cast<std::uint32_t>(createdForms.size()));
+		}
 	}
-	return result;
-}
 
-stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> DataStorage::GetSoundFlags(std::list<std::string> a_flagsList)
-{
-	stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> flags;
-	int numFlags = 0;
-	for (auto flagString : a_flagsList) {
-		numFlags++;
-		if (flagString == "Pleasant") {
-			flags.set(RE::TESRegionDataSound::Sound::Flag::kPleasant);
-		} else if (flagString == "Cloudy") {
-			flags.set(RE::TESRegionDataSound::Sound::Flag::kCloudy);
-		} else if (flagString == "Rainy") {
-			flags.set(RE::TESRegionDataSound::Sound::Flag::kRainy);
-		} else if (flagString == "Snowy") {
-			flags.set(RE::TESRegionDataSound::Sound::Flag::kSnowy);
-		} else {
-			numFlags--;
+	// A descriptor name hides a game EditorID of the same name
+	for (auto& [pack, forms] : a_resolvedForms) {
+		for (std::size_t i = 0; i < forms.size(); i++) {
+			const auto& identifier = pack->identifiers[i];
+			if (!identifier.IsEditorID())
+				continue;
+			if (const auto descriptor = soundDescriptors.Find(pack->GetString(identifier.value)))
+				forms[i] = descriptor;
 		}
 	}
-	if (!numFlags)
-		flags.set(RE::TESRegionDataSound::Sound::Flag::kNone);
-	return flags;
 }
 
-RE::TESRegionDataSound::Sound* GetOrCreateSound(bool& aout_created, RE::BSTArray<RE::TESRegionDataSound::Sound*> a_sounds, RE::BGSSoundDescriptorForm* a_soundDescriptor)
+DataStorage::ResolvedForms DataStorage::CreateSoundPools(const ResolvedForms& a_resolvedForms)
 {
-	for (auto sound : a_sounds) {
-		if (sound->sound == a_soundDescriptor) {
-			aout_created = false;
-			return sound;
+	SRD_TRACE_SCOPE("Sound pools");
+
+	ResolvedForms result;
+	std::vector<RE::BGSSoundDescriptorForm*> members;
+	std::vector<float> weights;
+
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		const auto& forms = a_resolvedForms.at(&pack);
+		auto& proxies = result[&pack];
+		proxies.resize(pack.pools.size());
+
+		for (const auto& record : pack.GetRecords(pack.configs[config.index])) {
+			for (const auto& field : pack.GetFields(record)) {
+				if (!(field.presence & Pack::Field::kPool))
+					continue;
+
+				members.clear();
+				weights.clear();
+				for (const auto& member : pack.GetMembers(pack.pools[field.value])) {
+					const auto form = forms[member.sound];
+					const auto sound = form ? form->As<RE::BGSSoundDescriptorForm>() : nullptr;
+					if (!sound)
+						logger::warn("	Form {} of the {} pool does not exist in {}, it is left out of the pool", pack.FormatIdentifier(member.sound), Schema::GetFieldName(record.section, field.key), config.filename);
+					members.push_back(sound);
+					weights.push_back(member.weight);
+				}
+				const auto proxy = soundPools.Add(members, weights);
+				if (proxy)
+					createdForms.try_emplace(proxy, static_cast<std::uint32_t>(createdForms.size()));
+				proxies[field.value] = proxy;
+			}
 		}
 	}
-	aout_created = true;
-	auto soundRecord = new RE::TESRegionDataSound::Sound;
-	return a_sounds.emplace_back(soundRecord);
+
+	if (const auto count = soundPools.GetPendingCount()) {
+		soundPools.Publish();
+		logger::info("Created {} sound pools", count);
+	}
+	return result;
 }
 
-void DataStorage::RunConfig(json& a_jsonData)
+void DataStorage::CollectPreloads(const ResolvedForms& a_resolvedForms)
 {
-	static const auto dataHandler = RE::TESDataHandler::GetSingleton();
-	bool load = true;
+	using Priority = Preloader::Priority;
+
+	if (!Settings::GetSingleton()->preloadBudget)
+		return;
+
+	SRD_TRACE_SCOPE("Preload");
 
-	for (auto& record : a_jsonData["Requirements"]) {
-		std::string modname = record;
-		bool notLoad = false;
-		if (modname.ends_with('!')) {
-			notLoad = true;
-			modname.pop_back();
-			if (!IsModLoaded(modname))
+	// Config descriptors bring their paths, the first definition of a name is the one that was created
+	std::unordered_map<const RE::BGSSoundDescriptorForm*, std::vector<std::string>> configFiles;
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		for (const auto& descriptor : pack.GetDescriptors(pack.configs[config.index])) {
+			const auto form = soundDescriptors.Find(pack.GetString(descriptor.name));
+			if (!form || configFiles.contains(form))
 				continue;
-		} else if (IsModLoaded(modname))
-			continue;
-		if (notLoad)
-			logger::info("	Missing requirement NOT {}", modname);
-		else
-			logger::info("	Missing requirement {}", modname);
-		load = false;
-	}
-
-	if (load) {
-		for (auto& record : a_jsonData["Regions"]) {
-			if (auto regn = LookupForm<RE::TESRegion>(record)) {
-				RE::TESRegionDataSound* regionDataEntry = nullptr;
-				for (auto entry : regn->dataList->regionDataList) {
-					if (entry->GetType() == RE::TESRegionData::Type::kSound) {
-						const auto regionDataManager = dataHandler->GetRegionDataManager();
-						if (regionDataManager)
-							regionDataEntry = regionDataManager->AsRegionDataSound(entry);
-						if (regionDataEntry)
-							break;
-					}
-				}
-				if (regionDataEntry) {
-					for (auto rdsa : record["RDSA"]) {
-						RE::BGSSoundDescriptorForm* sound = nullptr;
-						if (LookupFormString<RE::BGSSoundDescriptorForm>(&sound, rdsa, "Sound")) {
-							bool created;
-							std::list<std::string> changes;
-							auto soundRecord = GetOrCreateSound(created, regionDataEntry->sounds, sound);
-							soundRecord->sound = sound;
-
-							if (rdsa.contains("Flags")) {
-								soundRecord->flags = GetSoundFlags(split(rdsa["Flags"], ' '));
-								changes.emplace_back("Flags");
-							} else if (created) {
-								soundRecord->flags = GetSoundFlags({ "Pleasant", "Cloudy", "Rainy", "Snowy" });
-								changes.emplace_back("Flags");
-							}
-							if (rdsa.contains("Chance")) {
-								soundRecord->chance = rdsa["Chance"];
-								changes.emplace_back("Chance");
-							} else if (created) {
-								soundRecord->chance = 0.05f;
-								changes.emplace_back("Chance");
-							}
-
-							regionDataEntry->sounds.emplace_back(soundRecord);
-							InsertConflictInformationRegions(regn, sound, changes);
-						}
-					}
+			auto& files = configFiles[form];
+			for (const auto file : pack.GetFiles(descriptor))
+				files.emplace_back(pack.GetString(file));
+		}
+	}
+
+	const auto add = [&](const Pack::View& a_pack, std::uint32_t a_identifier, Priority a_priority) {
+		const auto form = a_identifier != Pack::kNone ? a_resolvedForms.at(&a_pack)[a_identifier] : nullptr;
+		const auto sound = form ? form->As<RE::BGSSoundDescriptorForm>() : nullptr;
+		if (!sound)
+			return;
+		const auto files = configFiles.find(sound);
+		preloader.Add(sound, a_priority, files != configFiles.end() ? std::span<const std::string>(files->second) : std::span<const std::string>{});
+	};
+
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		for (const auto& record : pack.GetRecords(pack.configs[config.index])) {
+			auto priority = Priority::kOther;
+			if (record.section == Schema::Section::kWeapons)
+				priority = Priority::kWeapons;
+			else if (record.section == Schema::Section::kRegions)
+				priority = Priority::kRegions;
+			for (const auto& field : pack.GetFields(record)) {
+				if (Schema::GetFieldRecord(record.section, field.key) != "SNDR")
+					continue;
+				if (field.presence & Pack::Field::kPool) {
+					for (const auto& member : pack.GetMembers(pack.pools[field.value]))
+						add(pack, member.sound, priority);
 				} else {
-					std::string errorMessage = std::format("RDSA entry does not exist in {}", FormUtil::GetIdentifierFromForm(regn));
-					logger::error("	{}", errorMessage);
-					RE::DebugMessageBox(std::format("{}\n{}", currentFilename, errorMessage).c_str());
+					add(pack, field.value, priority);
 				}
 			}
 		}
+		for (const auto& replacement : pack.GetReplacements(pack.configs[config.index]))
+			add(pack, replacement.with, Priority::kOther);
+	}
+}
 
-		for (auto& record : a_jsonData["Weapons"]) {
-			if (auto weap = LookupForm<RE::TESObjectWEAP>(record)) {
-				std::list<std::string> changes;
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->pickupSound, record, "Pick Up"))
-					changes.emplace_back("Pick Up");
+RuleIndex DataStorage::BuildRuleIndex(const ResolvedForms& a_resolvedForms)
+{
+	SRD_TRACE_SCOPE("Rules");
+	AllocationStats::Scope scope(AllocationStats::Phase::kResolve);
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->putdownSound, record, "Put Down"))
-					changes.emplace_back("Put Down");
+	RuleIndex index;
+	std::size_t ruleCount = 0;
 
-				if (LookupFormString<RE::BGSImpactDataSet>(&weap->impactDataSet, record, "Impact Data Set"))
-					changes.emplace_back("Impact Data Set");
+	const auto lookupKeyword = [&](const Pack::View& a_pack, std::uint32_t a_identifier) -> RE::BGSKeyword* {
+		const auto form = a_resolvedForms.at(&a_pack)[a_identifier];
+		return form ? form->As<RE::BGSKeyword>() : nullptr;
+	};
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->attackSound, record, "Attack"))
-					changes.emplace_back("Attack");
+	for (const auto& config : loader.configs) {
+		for (const auto& record : config.pack->GetRecords(config.pack->configs[config.index])) {
+			if (!record.IsRule())
+				continue;
+			ruleCount++;
+			if (!index.Add(*config.pack, record, lookupKeyword))
+				logger::debug("	Rule in {} can't match in this load order, a required keyword or every plugin is missing", config.filename);
+		}
+	}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->attackSound2D, record, "Attack 2D"))
-					changes.emplace_back("Attack 2D");
+	if (!ruleCount)
+		return index;
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->attackLoopSound, record, "Attack Loop"))
-					changes.emplace_back("Attack Loop");
+	for (std::size_t s = 0; s < std::size(sections); s++) {
+		const auto section = static_cast<Schema::Section>(s);
+		if (index.HasRules(section)) {
+			SRD_TRACE_SCOPE("Match rules", std::string(Schema::GetSection(section).name));
+			(index.*sections[s].matchRules)(section);
+		}
+	}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->attackFailSound, record, "Attack Fail"))
-					changes.emplace_back("Attack Fail");
+	logger::info("Matched {} rules", ruleCount);
+	return index;
+}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->idleSound, record, "Idle"))
-					changes.emplace_back("Idle");
+const EditorIDIndex& DataStorage::GetEditorIDIndex()
+{
+	if (editorIDIndex)
+		return *editorIDIndex;
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&weap->equipSound, record, "Equip"))
-					changes.emplace_back("Equip");
+	SRD_TRACE_SCOPE("EditorID index");
+	using clock = std::chrono::steady_clock;
+	const auto begin = clock::now();
 
-				if (auto nam8 = LookupFormString<RE::BGSSoundDescriptorForm>(&weap->unequipSound, record, "Unequip"))
-					changes.emplace_back("Unequip");
+	std::vector<std::string> plugins;
+	for (const auto file : RE::TESDataHandler::GetSingleton()->files) {
+		if (file)
+			plugins.emplace_back(file->GetFilename());
+	}
 
-				InsertConflictInformation(weap, changes);
-			}
+	std::filesystem::path cachePath;
+	if (Settings::GetSingleton()->editorIDCache) {
+		if (auto path = logger::log_directory()) {
+			*path /= std::format("{}.editorids.cache", Plugin::NAME);
+			cachePath = std::move(*path);
 		}
+	}
 
-		for (auto& record : a_jsonData["Magic Effects"]) {
-			if (auto mgef = LookupForm<RE::EffectSetting>(record)) {
-				static const char* names[6] = {
-					"Sheathe/Draw",
-					"Charge",
-					"Ready",
-					"Release",
-					"Cast Loop",
-					"On Hit"
-				};
-				std::list<std::string> changes;
-				RE::BGSSoundDescriptorForm* slots[6];
-				bool useSlots[6] = { false, false, false, false, false, false };
-
-				for (int i = 0; i < 6; i++) {
-					auto soundID = names[i];
-					useSlots[i] = LookupFormString<RE::BGSSoundDescriptorForm>(&slots[i], record, soundID);
-					if (useSlots[i])
-						changes.emplace_back(soundID);
-				}
+	std::vector<std::string> errors;
+	editorIDIndex.emplace();
+	editorIDIndex->Build(R"(Data\)", plugins, EditorIDIndex::GetSignatures(), cachePath, errors);
+	for (const auto& error : errors)
+		logger::warn("{}", error);
 
-				for (auto sndd : mgef->effectSounds) {
-					int i = (int)sndd.id;
-					if (useSlots[i]) {
-						sndd.sound = slots[i];
-						sndd.pad04 = (bool)slots[i];
-						useSlots[i] = false;
-					}
-				}
+	const auto& stats = editorIDIndex->GetStats();
+	logger::info("Indexed {} EditorIDs of {} plugins ({} from the cache) in {} ms", stats.editorIDs, stats.plugins, stats.cachedPlugins,
+		std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - begin).count());
+	return *editorIDIndex;
+}
 
-				for (int i = 0; i < 6; i++) {
-					if (useSlots[i]) {
-						RE::EffectSetting::SoundPair soundPair;
-						soundPair.id = (RE::MagicSystem::SoundID)i;
-						soundPair.sound = slots[i];
-						soundPair.pad04 = (bool)slots[i];
-						mgef->effectSounds.emplace_back(soundPair);
-					}
-				}
-				InsertConflictInformation(mgef, changes);
-			}
+DataStorage::ResolvedForms DataStorage::ResolveIdentifiers()
+{
+	SRD_TRACE_SCOPE("Resolve");
+	AllocationStats::Scope scope(AllocationStats::Phase::kResolve);
+
+	constexpr std::uint32_t formIDSlot = 0x80000000;
+	constexpr std::size_t batchSize = 256;
+
+	// Unique identifiers of every pack, a pack identifier maps to a slot of one of them
+	std::vector<std::string_view> editorIDs;
+	std::vector<std::pair<std::string_view, RE::FormID>> formIDs;
+	std::unordered_map<std::string_view, std::uint32_t> editorIDSlots;
+	std::map<std::pair<std::string_view, RE::FormID>, std::uint32_t> formIDSlots;
+	std::unordered_map<const Pack::View*, std::vector<std::uint32_t>> packSlots;
+
+	const auto add = [&](const Pack::View& a_pack, std::vector<std::uint32_t>& a_slots, std::uint32_t a_identifier) {
+		if (a_identifier == Pack::kNone || a_slots[a_identifier] != Pack::kNone)
+			return;
+		const auto& identifier = a_pack.identifiers[a_identifier];
+		if (identifier.IsEditorID()) {
+			const auto [it, inserted] = editorIDSlots.try_emplace(a_pack.GetString(identifier.value), static_cast<std::uint32_t>(editorIDs.size()));
+			if (inserted)
+				editorIDs.push_back(it->first);
+			a_slots[a_identifier] = it->second;
+		} else {
+			const auto [it, inserted] = formIDSlots.try_emplace({ a_pack.GetString(identifier.plugin), identifier.value }, static_cast<std::uint32_t>(formIDs.size()));
+			if (inserted)
+				formIDs.push_back(it->first);
+			a_slots[a_identifier] = it->second | formIDSlot;
 		}
+	};
 
-		for (auto& record : a_jsonData["Armor Addons"]) {
-			if (auto arma = LookupForm<RE::TESObjectARMA>(record)) {
-				std::list<std::string> changes;
+	for (const auto& config : loader.configs) {
+		const auto& pack = *config.pack;
+		auto& slots = packSlots[&pack];
+		if (slots.empty())
+			slots.resize(pack.identifiers.size(), Pack::kNone);
 
-				if (LookupFormString<RE::BGSFootstepSet>(&arma->footstepSet, record, "Footstep"))
-					changes.emplace_back("Footstep");
+		for (const auto& descriptor : pack.GetDescriptors(pack.configs[config.index])) {
+			add(pack, slots, descriptor.category);
+			add(pack, slots, descriptor.outputModel);
+		}
+
+		for (const auto& replacement : pack.GetReplacements(pack.configs[config.index])) {
+			add(pack, slots, replacement.sound);
+			add(pack, slots, replacement.with);
+		}
 
-				InsertConflictInformation(arma, changes);
+		for (const auto& record : pack.GetRecords(pack.configs[config.index])) {
+			if (record.IsRule()) {
+				const auto& rule = pack.GetRule(record);
+				for (const auto keyword : pack.GetKeywords(rule))
+					add(pack, slots, keyword);
+				for (const auto keyword : pack.GetExcludedKeywords(rule))
+					add(pack, slots, keyword);
+			} else {
+				add(pack, slots, record.form);
+			}
+			for (const auto& field : pack.GetFields(record)) {
+				if (field.presence & Pack::Field::kPool) {
+					for (const auto& member : pack.GetMembers(pack.pools[field.value]))
+						add(pack, slots, member.sound);
+				} else {
+					add(pack, slots, field.value);
+				}
 			}
 		}
+	}
 
-		for (auto& record : a_jsonData["Armors"]) {
-			if (auto armo = LookupForm<RE::TESObjectARMO>(record)) {
-				std::list<std::string> changes;
+	// Both lookups only read game data at this point, MergeMapper pairs were translated by BuildMergeTable
+	std::vector<RE::TESForm*> editorIDForms(editorIDs.size());
+	std::vector<RE::TESForm*> formIDForms(formIDs.size());
+
+	struct Batch
+	{
+		bool editorIDs;
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	std::vector<Batch> batches;
+	for (std::size_t i = 0; i < editorIDs.size(); i += batchSize)
+		batches.emplace_back(true, i, std::min(i + batchSize, editorIDs.size()));
+	for (std::size_t i = 0; i < formIDs.size(); i += batchSize)
+		batches.emplace_back(false, i, std::min(i + batchSize, formIDs.size()));
+
+	std::for_each(std::execution::par, batches.begin(), batches.end(), [&](const Batch& a_batch) {
+		AllocationStats::Scope scope(AllocationStats::Phase::kResolve);
+		for (auto i = a_batch.begin; i < a_batch.end; i++) {
+			if (a_batch.editorIDs)
+				editorIDForms[i] = RE::TESForm::LookupByEditorID(editorIDs[i]);
+			else
+				formIDForms[i] = FormUtil::GetForm(formIDs[i].first, formIDs[i].second);
+		}
+	});
+
+	// The game drops the EditorIDs of most form types, those fall back to the index read from the plugin files
+	std::size_t indexed = 0;
+	if (Settings::GetSingleton()->editorIDIndex && std::ranges::find(editorIDForms, nullptr) != editorIDForms.end()) {
+		const auto& index = GetEditorIDIndex();
+		for (std::size_t i = 0; i < editorIDs.size(); i++) {
+			if (editorIDForms[i])
+				continue;
+			if (const auto entry = index.Find(editorIDs[i])) {
+				editorIDForms[i] = FormUtil::GetForm(entry->plugin, entry->localID);
+				indexed += editorIDForms[i] != nullptr;
+			}
+		}
+	}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&armo->pickupSound, record, "Pick Up"))
-					changes.emplace_back("Pick Up");
+	ResolvedForms result;
+	for (const auto& [pack, slots] : packSlots) {
+		auto& forms = result[pack];
+		forms.resize(slots.size());
+		for (std::size_t i = 0; i < slots.size(); i++) {
+			if (slots[i] == Pack::kNone)
+				continue;
+			forms[i] = slots[i] & formIDSlot ? formIDForms[slots[i] & ~formIDSlot] : editorIDForms[slots[i]];
+		}
+	}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&armo->putdownSound, record, "Put Down"))
-					changes.emplace_back("Put Down");
+	logger::info("Resolved {} EditorIDs ({} through the EditorID index) and {} FormIDs in {} batches", editorIDs.size(), indexed, formIDs.size(), batches.size());
+	return result;
+}
 
-				InsertConflictInformation(armo, changes);
-			}
-		}
+template <ConflictTracking Mode>
+void DataStorage::ApplyReplacements(const ResolvedForms& a_resolvedForms)
+{
+	if (std::ranges::none_of(loader.configs, [](const ConfigLoader::Config& a_config) { return a_config.pack->configs[a_config.index].replacementCount != 0; }))
+		return;
 
-		for (auto& record : a_jsonData["Misc. Items"]) {
-			if (auto misc = LookupForm<RE::TESObjectMISC>(record)) {
-				std::list<std::string> changes;
+	SRD_TRACE_SCOPE("Replace");
+	AllocationStats::Scope scope(AllocationStats::Phase::kResolve);
+
+	// Built once from the sounds forms have before any config, so replacements don't chain
+	SoundUsage usage;
+	usage.Build();
+
+	ApplyBuffer buffer;
+	std::size_t replacements = 0;
+	std::size_t uses = 0;
+	for (std::uint32_t i = 0; i < loader.configs.size(); i++) {
+		const auto& config = loader.configs[i];
+		const auto& pack = *config.pack;
+		const auto& forms = a_resolvedForms.at(&pack);
+		TrackedApplyContext<Mode> ctx{ { i, config.filename, pack, forms, {}, buffer, createdForms } };
+
+		const auto lookup = [&](std::uint32_t a_identifier) -> RE::BGSSoundDescriptorForm* {
+			const auto form = forms[a_identifier];
+			const auto sound = form ? form->As<RE::BGSSoundDescriptorForm>() : nullptr;
+			if (!sound)
+				logger::warn("	Form {} of BGSSoundDescriptorForm does not exist in {}, skipping replacement", pack.FormatIdentifier(a_identifier), config.filename);
+			return sound;
+		};
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&misc->pickupSound, record, "Pick Up"))
-					changes.emplace_back("Pick Up");
+		for (const auto& replacement : pack.GetReplacements(pack.configs[config.index])) {
+			const auto sound = lookup(replacement.sound);
+			const auto with = lookup(replacement.with);
+			if (!sound || !with)
+				continue;
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&misc->putdownSound, record, "Put Down"))
-					changes.emplace_back("Put Down");
+			replacements++;
+			for (const auto& use : usage.GetUses(sound)) {
+				if (use.slot) {
+					*use.slot = with;
+				} else if (with->GetFormID()) {
+					*use.formID = with->GetFormID();
+				} else {
+					// Weather sounds are stored by form ID, which pool proxies and config sound descriptors don't have
+					logger::warn("	Sound {} in {} is a config sound descriptor, it does not replace weather sounds", pack.FormatIdentifier(replacement.with), config.filename);
+					continue;
+				}
 
-				InsertConflictInformation(misc, changes);
+				// Region and weather sounds are lists, their edits are grouped by the sound that was replaced
+				if (use.section == Schema::Section::kRegions || use.section == Schema::Section::kWeathers)
+					ctx.InsertConflictInformationRegions(use.form, sound, "Sound"sv, ctx.GetKey(with));
+				else
+					ctx.InsertConflictInformation(use.form, Schema::GetFieldName(use.section, use.field), with);
+				uses++;
 			}
 		}
+	}
 
-		for (auto& record : a_jsonData["Soul Gems"]) {
-			if (auto slgm = LookupForm<RE::TESSoulGem>(record)) {
-				std::list<std::string> changes;
-
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&slgm->pickupSound, record, "Pick Up"))
-					changes.emplace_back("Pick Up");
-
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&slgm->putdownSound, record, "Put Down"))
-					changes.emplace_back("Put Down");
+	MergeApplyBuffer(buffer);
+	logger::info("Replaced {} sounds in {} fields, {} uses of {} sounds indexed", replacements, uses, usage.GetSize(), usage.GetSoundCount());
+}
 
-				InsertConflictInformation(slgm, changes);
-			}
+template <ConflictTracking Mode>
+void DataStorage::ReserveConflicts(std::span<Shard> a_shards)
+{
+	if constexpr (Mode == ConflictTracking::kFull) {
+		for (auto& shard : a_shards) {
+			std::size_t conflicts = 0;
+			for (const auto& task : shard.tasks)
+				conflicts += task.record->GetMaxConflicts();
+			shard.buffer.conflicts.reserve(conflicts);
 		}
+	}
+}
 
-		for (auto& record : a_jsonData["Projectiles"]) {
-			if (auto proj = LookupForm<RE::BGSProjectile>(record)) {
-				std::list<std::string> changes;
+template <ConflictTracking Mode>
+std::size_t DataStorage::ApplyShard(Shard& a_shard, std::size_t a_first, const ResolvedForms& a_resolvedForms, const ResolvedForms& a_resolvedPools, std::chrono::steady_clock::time_point a_deadline)
+{
+	static_assert(std::size(applyFunctions<Mode>) == static_cast<std::size_t>(Schema::Section::kTotal));
+
+	// Checking the clock after every record would cost more than small records take to apply
+	constexpr std::size_t clockInterval = 16;
+
+	// Declared first so the span's own allocations fall outside the apply budget
+	SRD_TRACE_SCOPE("Apply shard", std::string(Schema::GetSection(a_shard.id).name));
+	AllocationStats::Scope scope(AllocationStats::Phase::kApply, a_shard.id);
+	const auto function = applyFunctions<Mode>[static_cast<std::size_t>(a_shard.id)];
+	const bool timed = a_deadline != std::chrono::steady_clock::time_point::max();
+
+	auto i = a_first;
+	for (; i < a_shard.tasks.size(); i++) {
+		if (timed && i != a_first && (i - a_first) % clockInterval == 0 && std::chrono::steady_clock::now() >= a_deadline)
+			break;
+
+		const auto& task = a_shard.tasks[i];
+		const auto& config = loader.configs[task.config];
+		const auto forms = a_resolvedForms.find(config.pack);
+		const auto pools = a_resolvedPools.find(config.pack);
+		TrackedApplyContext<Mode> ctx{ { task.config, config.filename, *config.pack,
+			forms != a_resolvedForms.end() ? std::span{ forms->second } : std::span<RE::TESForm* const>{},
+			pools != a_resolvedPools.end() ? std::span{ pools->second } : std::span<RE::TESForm* const>{},
+			a_shard.buffer, createdForms } };
+		try {
+			(this->*function)(ctx, task.form, *task.record);
+		} catch (const std::exception& exc) {
+			a_shard.buffer.errors.emplace_back(std::format("Failed to apply entry in {}\n{}", config.filename, exc.what()));
+		}
+	}
+	return i;
+}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&proj->data.activeSoundLoop, record, "Active"))
-					changes.emplace_back("Active");
+template <ConflictTracking Mode>
+void DataStorage::ApplyShards(std::span<Shard> a_shards, const ResolvedForms& a_resolvedForms, const ResolvedForms& a_resolvedPools)
+{
+	ReserveConflicts<Mode>(a_shards);
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&proj->data.countdownSound, record, "Countdown"))
-					changes.emplace_back("Countdown");
+	const auto apply = [&](Shard& a_shard) { ApplyShard<Mode>(a_shard, 0, a_resolvedForms, a_resolvedPools); };
+	if constexpr (AllocationStats::enabled) {
+		// Serial, so that allocations of the parallel algorithm itself don't count towards the records
+		std::ranges::for_each(a_shards, apply);
+	} else {
+		std::for_each(std::execution::par, a_shards.begin(), a_shards.end(), apply);
+	}
 
-				if (auto deactivateSound = LookupFormString<RE::BGSSoundDescriptorForm>(&proj->data.deactivateSound, record, "Deactivate"))
-					changes.emplace_back("Deactivate");
+	FinishShards<Mode>(a_shards);
+}
 
-				InsertConflictInformation(proj, changes);
-			}
+template <ConflictTracking Mode>
+void DataStorage::FinishShards(std::span<Shard> a_shards)
+{
+	if constexpr (AllocationStats::enabled) {
+		// Applying a record whose forms all resolved must not allocate, errors are the only exception
+		for (std::size_t s = 0; s < std::size(sections); s++) {
+			const auto section = static_cast<Schema::Section>(s);
+			const bool failed = std::ranges::any_of(a_shards, [&](const Shard& a_shard) { return a_shard.id == section && !a_shard.buffer.errors.empty(); });
+			if (const auto count = AllocationStats::Get(AllocationStats::Phase::kApply, section); count.allocations && !failed)
+				logger::error("Allocation budget exceeded: {} allocations ({} bytes) while applying {}", count.allocations, count.bytes, Schema::GetSection(section).name);
 		}
+	}
 
-		for (auto& record : a_jsonData["Explosions"]) {
-			if (auto expl = LookupForm<RE::BGSExplosion>(record)) {
-				std::list<std::string> changes;
+	if constexpr (Mode == ConflictTracking::kCounts) {
+		std::array<std::size_t, static_cast<std::size_t>(Schema::Section::kTotal)> counts{};
+		for (const auto& shard : a_shards)
+			counts[static_cast<std::size_t>(shard.id)] += shard.buffer.edits;
+		for (std::size_t s = 0; s < counts.size(); s++) {
+			if (counts[s])
+				logger::info("{}: {} field edits", Schema::sections[s].name, counts[s]);
+		}
+	}
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&expl->data.sound1, record, "Interior"))
-					changes.emplace_back("Interior");
+	for (auto& shard : a_shards)
+		MergeApplyBuffer(shard.buffer);
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&expl->data.sound1, record, "Exterior"))
-					changes.emplace_back("Exterior");
+	if constexpr (Mode == ConflictTracking::kFull)
+		PublishSnapshot();
+}
 
-				InsertConflictInformation(expl, changes);
-			}
+template <ConflictTracking Mode>
+bool DataStorage::ApplySlice(std::chrono::steady_clock::time_point a_deadline)
+{
+	auto& state = *sliced;
+	const auto unlimited = a_deadline == std::chrono::steady_clock::time_point::max();
+
+	// A forced finish applies the shard in progress, then every untouched shard in parallel
+	while (state.shard < state.shards.size()) {
+		auto& shard = state.shards[state.shard];
+		state.task = ApplyShard<Mode>(shard, state.task, state.resolvedForms, state.resolvedPools, a_deadline);
+		if (state.task < shard.tasks.size())
+			return false;
+		state.shard++;
+		state.task = 0;
+
+		if (unlimited && !AllocationStats::enabled) {
+			const auto rest = std::span{ state.shards }.subspan(state.shard);
+			std::for_each(std::execution::par, rest.begin(), rest.end(), [&](Shard& a_shard) { ApplyShard<Mode>(a_shard, 0, state.resolvedForms, state.resolvedPools); });
+			state.shard = state.shards.size();
+		} else if (std::chrono::steady_clock::now() >= a_deadline) {
+			break;
 		}
+	}
 
-		for (auto& record : a_jsonData["Effect Shaders"]) {
-			if (auto efsh = LookupForm<RE::TESEffectShader>(record)) {
-				std::list<std::string> changes;
+	if (state.shard < state.shards.size())
+		return false;
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&efsh->data.ambientSound, record, "Ambient"))
-					changes.emplace_back("Ambient");
+	FinishShards<Mode>(state.shards);
+	return true;
+}
 
-				InsertConflictInformation(efsh, changes);
-			}
-		}
+void DataStorage::QueueSlice()
+{
+	SKSE::GetTaskInterface()->AddTask([this] {
+		if (!sliced)
+			return;  // finished early by a game load
+
+		using clock = std::chrono::steady_clock;
+		const auto begin = clock::now();
+		const bool done = (this->*sliced->apply)(begin + sliced->budget);
+		const auto duration = clock::now() - begin;
+
+		sliced->slices++;
+		sliced->worstSlice = std::max(sliced->worstSlice, duration);
+		if (done)
+			CompleteSlicedApply();
+		else
+			QueueSlice();
+	});
+}
 
-		for (auto& record : a_jsonData["Ingestibles"]) {
-			if (auto efsh = LookupForm<RE::AlchemyItem>(record)) {
-				std::list<std::string> changes;
+void DataStorage::FinishApply()
+{
+	if (!sliced)
+		return;
 
-				if (LookupFormString<RE::BGSSoundDescriptorForm>(&efsh->data.consumptionSound, record, "Consume"))
-					changes.emplace_back("Consume");
+	using clock = std::chrono::steady_clock;
+	const auto begin = clock::now();
+	(this->*sliced->apply)(clock::time_point::max());
+	logger::info("Forced the remaining sliced apply work to finish in {} ms before the game loads",
+		std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - begin).count());
+	CompleteSlicedApply();
+}
 
-				InsertConflictInformation(efsh, changes);
-			}
+void DataStorage::StartPreload()
+{
+	preloader.Start(Settings::GetSingleton()->preloadBudget);
+}
+
+void DataStorage::CompleteSlicedApply()
+{
+	using ms = std::chrono::duration<double, std::milli>;
+	logger::info("Applied configs in {} slices over {} ms, worst slice {:.2f} ms",
+		sliced->slices,
+		std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sliced->begin).count(),
+		std::chrono::duration_cast<ms>(sliced->worstSlice).count());
+	sliced.reset();
+	ReportLoad();
+}
+
+void DataStorage::ApplyConfigs()
+{
+	static_assert(std::size(sections) == static_cast<std::size_t>(Schema::Section::kTotal));
+
+	const std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+	constexpr std::size_t minShardSize = 64;
+
+	std::vector<Shard> shards;
+	ApplyBuffer resolveBuffer;
+
+	BuildMergeTable();
+	auto resolvedForms = ResolveIdentifiers();
+	CreateSoundDescriptors(resolvedForms);
+	auto resolvedPools = CreateSoundPools(resolvedForms);
+	CollectPreloads(resolvedForms);
+	const auto ruleIndex = BuildRuleIndex(resolvedForms);
+
+	auto sectionTasks = [&] {
+		SRD_TRACE_SCOPE("Plan");
+		return loader.PlanRecords<RE::TESForm*>(
+			[&](std::uint32_t a_config, const Pack::Record& a_record) {
+				const auto& config = loader.configs[a_config];
+				ApplyContext ctx{ a_config, config.filename, *config.pack, resolvedForms.at(config.pack), {}, resolveBuffer, createdForms };
+				AllocationStats::Scope scope(AllocationStats::Phase::kResolve, a_record.section);
+				return (this->*sections[static_cast<std::size_t>(a_record.section)].resolve)(ctx, a_record);
+			},
+			[&](std::uint32_t, const Pack::Record& a_record) { return ruleIndex.GetMatches(a_record); },
+			[](const RE::TESForm* a_form) { return a_form->GetFormID(); });
+	}();
+
+	MergeApplyBuffer(resolveBuffer);
+
+	for (std::size_t s = 0; s < std::size(sections); s++) {
+		auto& tasks = sectionTasks[s];
+		if (tasks.empty())
+			continue;
+
+		const std::size_t shardSize = std::max(minShardSize, tasks.size() / workers + 1);
+		std::size_t begin = 0;
+		while (begin < tasks.size()) {
+			auto end = std::min(begin + shardSize, tasks.size());
+			while (end < tasks.size() && tasks[end].form == tasks[end - 1].form)
+				end++;
+			shards.emplace_back(static_cast<Schema::Section>(s), std::span{ tasks.data() + begin, end - begin });
+			begin = end;
 		}
 	}
+
+	conflictTracking = fixedConflictTracking.value_or(Settings::GetSingleton()->conflictTracking);
+
+	// Calls a_function with the tracking mode as a compile-time constant
+	const auto dispatch = [&](auto a_function) {
+#ifdef SRD_CONFLICT_TRACKING
+		a_function(std::integral_constant<ConflictTracking, *fixedConflictTracking>{});
+#else
+		switch (conflictTracking) {
+		case ConflictTracking::kNone:
+			a_function(std::integral_constant<ConflictTracking, ConflictTracking::kNone>{});
+			break;
+		case ConflictTracking::kCounts:
+			a_function(std::integral_constant<ConflictTracking, ConflictTracking::kCounts>{});
+			break;
+		default:
+			a_function(std::integral_constant<ConflictTracking, ConflictTracking::kFull>{});
+			break;
+		}
+#endif
+	};
+
+	if (const auto budget = Settings::GetSingleton()->applySliceBudget; budget > 0ms) {
+		logger::info("Applying {} shards in slices of {} ms on the main thread", shards.size(), budget.count());
+		sliced = std::make_unique<SlicedApply>(std::move(sectionTasks), std::move(shards), std::move(resolvedForms), std::move(resolvedPools));
+		sliced->budget = budget;
+		sliced->begin = std::chrono::steady_clock::now();
+		dispatch([&]<ConflictTracking Mode>(std::integral_constant<ConflictTracking, Mode>) {
+			ApplyReplacements<Mode>(sliced->resolvedForms);
+			ReserveConflicts<Mode>(sliced->shards);
+			sliced->apply = &DataStorage::ApplySlice<Mode>;
+		});
+		QueueSlice();
+		return;
+	}
+
+	logger::info("Applying {} shards on {} workers", shards.size(), workers);
+	dispatch([&]<ConflictTracking Mode>(std::integral_constant<ConflictTracking, Mode>) {
+		ApplyReplacements<Mode>(resolvedForms);
+		ApplyShards<Mode>(shards, resolvedForms, resolvedPools);
+	});
 }
@@ -5,7 +5,16 @@
 #include <unordered_map>
 
 #include <nlohmann/json.hpp>
-#include <shared_mutex>
+
+#include "ConfigLoader.h"
+#include "ConflictTracking.h"
+#include "EditorIDIndex.h"
+#include "Preloader.h"
+#include "RuleIndex.h"
+#include "Snapshot.h"
+#include "SoundDescriptors.h"
+#include "SoundPools.h"
+#include "SoundUsage.h"
 using json = nlohmann::json;
 
 
@@ -18,38 +27,290 @@ public:
 		return &avInterface;
 	}
 
-	std::string currentFilename = "";
-	std::unordered_map<RE::TESForm*, std::unordered_map<RE::TESForm*, std::unordered_map<std::string, std::list<std::string>>>> conflictMapRegions;
-	std::unordered_map<RE::TESForm*, std::unordered_map<std::string, std::list<std::string>>> conflictMap;
+	// Creation index of every pool proxy and config sound descriptor of the current load. The game never gives
+	// these forms a form ID, so edits key them on this instead, see Snapshot::kCreated.
+	using CreatedForms = std::unordered_map<const RE::TESForm*, std::uint32_t>;
 
-	bool IsModLoaded(std::string_view a_modname);
+	// Conflict and error output of one apply shard, merged on the main thread once every shard is done.
+	// Conflicts are reserved up front so that applying a resolved record doesn't allocate.
+	struct ApplyBuffer
+	{
+		struct Conflict
+		{
+			RE::TESForm* form;
+			RE::TESForm* sound;
+			std::string_view field;  // points into Schema
+			std::uint32_t config;
+			std::uint64_t value;     // see Snapshot::Edit
+		};
+
+		std::vector<Conflict> conflicts;
+		std::vector<std::string> errors;
+		std::size_t edits = 0;  // only counted with ConflictTracking::kCounts
+	};
+
+	struct ApplyContext
+	{
+		std::uint32_t config;
+		const std::string& filename;
+		const Pack::View& pack;
+		std::span<RE::TESForm* const> forms;  // resolved pack identifiers, nullptr when missing
+		std::span<RE::TESForm* const> pools;  // pool proxies indexed like Pack::View::pools, nullptr when no member resolved
+		ApplyBuffer& buffer;
+		const CreatedForms& createdForms;
+
+		// Form a field sets, nullptr when it clears the field or its form is missing
+		RE::TESForm* GetValue(const Pack::Field& a_field) const
+		{
+			if (a_field.value == Pack::kNone)
+				return nullptr;
+			return (a_field.presence & Pack::Field::kPool) ? pools[a_field.value] : forms[a_field.value];
+		}
 
-	void InsertConflictField(std::unordered_map<std::string, std::list<std::string>>& a_conflicts, std::string a_field);
+		// What an edit records for a_form, see Snapshot::Edit
+		std::uint64_t GetKey(const RE::TESForm* a_form) const { return GetFormKey(createdForms, a_form); }
+	};
 
-	void InsertConflictInformationRegions(RE::TESForm* a_region, RE::TESForm* a_sound, std::list<std::string> a_fields);
-	void InsertConflictInformation(RE::TESForm* a_form, std::list<std::string> a_fields);
+	// Form ID of a_form, its creation index with Snapshot::kCreated when SRD created it, 0 for nullptr
+	static std::uint64_t GetFormKey(const CreatedForms& a_createdForms, const RE::TESForm* a_form)
+	{
+		if (!a_form)
+			return 0;
+		if (const auto formID = a_form->GetFormID())
+			return formID;
+		const auto it = a_createdForms.find(a_form);
+		return it != a_createdForms.end() ? Snapshot::kCreated | it->second : 0;
+	}
+
+	// Apply functions are instantiated per tracking mode, so the modes that don't record anything pay nothing
+	template <ConflictTracking Mode>
+	struct TrackedApplyContext : ApplyContext
+	{
+		void InsertConflictInformationRegions(RE::TESForm* a_region, RE::TESForm* a_sound, std::string_view a_field, std::uint64_t a_value)
+		{
+			if constexpr (Mode == ConflictTracking::kFull)
+				buffer.conflicts.emplace_back(a_region, a_sound, a_field, config, a_value);
+			else if constexpr (Mode == ConflictTracking::kCounts)
+				buffer.edits++;
+		}
 
-	std::pair<std::set<std::string>, std::set<std::string>> ScanConfigDirectory(); // Add this
-	std::map<std::string, std::set<std::string>> MatchPluginConfigs(const std::set<std::string>& pluginConfigs);  // Add this
-	void ParseAllConfigs( const std::map<std::string, std::set<std::string>>& pluginMap, const std::set<std::string>& generalConfigs); // Add this
-	void PrintConflicts(); // Add this
+		void InsertConflictInformation(RE::TESForm* a_form, std::string_view a_field, const RE::TESForm* a_value)
+		{
+			if constexpr (Mode == ConflictTracking::kFull)
+				buffer.conflicts.emplace_back(a_form, nullptr, a_field, config, GetKey(a_value));
+			else if constexpr (Mode == ConflictTracking::kCounts)
+				buffer.edits++;
+		}
+
+		// a_field was applied to a_form
+		void InsertConflictInformation(RE::TESForm* a_form, Schema::Section a_section, const Pack::Field& a_field)
+		{
+			if constexpr (Mode == ConflictTracking::kFull) {
+				buffer.conflicts.emplace_back(a_form, nullptr, Schema::GetFieldName(a_section, a_field.key), config, GetKey(GetValue(a_field)));
+			} else if constexpr (Mode == ConflictTracking::kCounts) {
+				buffer.edits++;
+			}
+		}
+	};
+
+	bool IsModLoaded(std::string_view a_modname);
+
+	void ApplyConfigs();
+	// Logs every field left with more than one write once identical overrides collapse, writes in apply order. Same
+	// rule as srdtool conflicts, a field written once is a change, not a conflict.
+	void PrintConflicts();
+
+	// Logs the digest of the published snapshot, and writes its final state when [Conflicts] WriteState is set
+	void ReportDigest();
 
 	void LoadConfigs();
-	void ParseConfigs(const std::set<std::string>& a_configs); // Change this to take const reference
-	void RunConfig(json& s_jsonData);
 
-	stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> GetSoundFlags(std::list<std::string> a_input);
+	// Applies whatever the time-sliced apply has left, before a save loads or a new game starts
+	void FinishApply();
+
+	// Starts reading the files of the distributed sounds once the player is loaded, see Preloader
+	void StartPreload();
+
+	stl::enumeration<RE::TESRegionDataSound::Sound::Flag, std::uint32_t> GetSoundFlags(std::uint8_t a_flags);
 
 private:
-	DataStorage() {
-	}
+	DataStorage();
+
+	void Log(ConfigLoader::Level a_level, const std::string& a_message);
+
+	// Appends the conflicts of a_buffer to edits in apply order and logs its errors. A conflict that writes the value
+	// its field already holds takes the place of the edit before it and is counted, so the last config that set a value
+	// is the one that is kept.
+	void MergeApplyBuffer(ApplyBuffer& a_buffer);
+
+	// Publishes the merged edits as the current Snapshot
+	void PublishSnapshot();
+
+	// Forms of every identifier of a pack, indexed like Pack::View::identifiers, nullptr when missing
+	using ResolvedForms = std::unordered_map<const Pack::View*, std::vector<RE::TESForm*>>;
 
 	template <typename T>
-	T* LookupEditorID(std::string a_editorID);
+	bool LookupFormString(ApplyContext& a_ctx, T** a_type, const Pack::Field& a_field, bool a_error = true);
 
 	template <typename T>
-	bool LookupFormString(T** a_type, json& a_record, std::string a_key, bool a_error = true);
+	T* LookupForm(ApplyContext& a_ctx, const Pack::Record& a_record);
+
+	// Queries MergeMapper once for every plugin|FormID identifier the loaded configs use
+	void BuildMergeTable();
+
+	// EditorIDs of the record types SRD edits read from the loaded plugins, built on first use and kept for the session
+	const EditorIDIndex& GetEditorIDIndex();
+
+	// Resolves every identifier the loaded configs use, records, rule keywords and field values. Identifiers are
+	// deduplicated across packs and looked up in parallel batches, EditorIDs and plugin|FormID pairs separately.
+	ResolvedForms ResolveIdentifiers();
+
+	// Creates the sound descriptors of every config and points the identifiers that name them at the new forms
+	void CreateSoundDescriptors(ResolvedForms& a_resolvedForms);
+
+	// Compiles the sound pools the loaded configs use and returns their proxies, indexed like Pack::View::pools
+	ResolvedForms CreateSoundPools(const ResolvedForms& a_resolvedForms);
+
+	// Hands every sound descriptor the configs distribute to the preloader, by the section that uses it
+	void CollectPreloads(const ResolvedForms& a_resolvedForms);
+
+	// Compiles the rule records of every config and matches them in one pass per form array
+	RuleIndex BuildRuleIndex(const ResolvedForms& a_resolvedForms);
 
 	template <typename T>
-	T* LookupForm(json& a_record);
+	RE::TESForm* ResolveRecord(ApplyContext& a_ctx, const Pack::Record& a_record);
+
+	template <ConflictTracking Mode>
+	void ApplyRegion(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyWeapon(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyMagicEffect(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyArmorAddon(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyPickUpPutDown(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyProjectile(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyExplosion(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyEffectShader(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyIngestible(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyAcousticSpace(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyCell(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyActivator(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyDoor(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyContainer(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyWater(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+	template <ConflictTracking Mode>
+	void ApplyWeather(TrackedApplyContext<Mode>& a_ctx, RE::TESForm* a_form, const Pack::Record& a_record);
+
+	struct Section
+	{
+		RE::TESForm* (DataStorage::*resolve)(ApplyContext&, const Pack::Record&);
+		void (RuleIndex::*matchRules)(Schema::Section);
+	};
+
+	template <ConflictTracking Mode>
+	using ApplyFunc = void (DataStorage::*)(TrackedApplyContext<Mode>&, RE::TESForm*, const Pack::Record&);
+
+	// Indexed by Schema::Section
+	static const Section sections[];
+	template <ConflictTracking Mode>
+	static const ApplyFunc<Mode> applyFunctions[];
+
+	// Records of one section, shards never split the records of one form so they write disjoint sets of forms
+	struct Shard
+	{
+		Schema::Section id;
+		std::span<ConfigLoader::Task<RE::TESForm*>> tasks;
+		ApplyBuffer buffer;
+	};
+
+	// Rewrites every use of the sounds of Replace entries through a reverse index of sound uses. Runs before the
+	// shards, so entries that name a form override a replacement of the same field.
+	template <ConflictTracking Mode>
+	void ApplyReplacements(const ResolvedForms& a_resolvedForms);
+
+	template <ConflictTracking Mode>
+	void ReserveConflicts(std::span<Shard> a_shards);
+
+	// Applies the tasks of a_shard from a_first on until a_deadline passes, returns the first task left
+	template <ConflictTracking Mode>
+	std::size_t ApplyShard(Shard& a_shard, std::size_t a_first, const ResolvedForms& a_resolvedForms, const ResolvedForms& a_resolvedPools,
+		std::chrono::steady_clock::time_point a_deadline = std::chrono::steady_clock::time_point::max());
+
+	template <ConflictTracking Mode>
+	void ApplyShards(std::span<Shard> a_shards, const ResolvedForms& a_resolvedForms, const ResolvedForms& a_resolvedPools);
+
+	// Merges the shard buffers and publishes the snapshot once every shard is applied
+	template <ConflictTracking Mode>
+	void FinishShards(std::span<Shard> a_shards);
+
+	// Everything the time-sliced apply needs between slices, see Settings::applySliceBudget
+	struct SlicedApply
+	{
+		std::vector<std::vector<ConfigLoader::Task<RE::TESForm*>>> sectionTasks;  // the shards point into these
+		std::vector<Shard> shards;
+		ResolvedForms resolvedForms;
+		ResolvedForms resolvedPools;
+		bool (DataStorage::*apply)(std::chrono::steady_clock::time_point) = nullptr;
+		std::chrono::milliseconds budget{};
+		std::chrono::steady_clock::time_point begin;
+		std::size_t shard = 0;
+		std::size_t task = 0;
+		std::size_t slices = 0;
+		std::chrono::steady_clock::duration worstSlice{};
+	};
+
+	// Applies sliced tasks until a_deadline passes, true once everything is applied and published
+	template <ConflictTracking Mode>
+	bool ApplySlice(std::chrono::steady_clock::time_point a_deadline);
+
+	// Queues the next slice on the game's main thread task queue
+	void QueueSlice();
+	void CompleteSlicedApply();
+
+	// Conflict summary, digest and load statistics, once every edit is applied
+	void ReportLoad();
+
+	ConfigLoader loader;
+	SoundDescriptors soundDescriptors;
+	SoundPools soundPools;
+	Preloader preloader;
+	std::optional<EditorIDIndex> editorIDIndex;
+	std::unique_ptr<SlicedApply> sliced;  // only while a time-sliced apply is running
+	std::vector<ApplyBuffer::Conflict> edits;  // merged from every shard until the snapshot is published
+
+	// Form, sound and field of a merged edit
+	struct EditKey
+	{
+		const RE::TESForm* form;
+		const RE::TESForm* sound;
+		std::string_view field;
+
+		bool operator==(const EditKey&) const = default;
+	};
+
+	struct EditKeyHash
+	{
+		std::size_t operator()(const EditKey& a_key) const
+		{
+			return std::hash<std::string_view>{}(a_key.field) ^ (std::hash<const RE::TESForm*>{}(a_key.form) * 0x9E3779B97F4A7C15ull) ^
+			       (std::hash<const RE::TESForm*>{}(a_key.sound) * 0xC2B2AE3D27D4EB4Full);
+		}
+	};
+
+	std::unordered_map<EditKey, std::size_t, EditKeyHash> lastEdits;  // index into edits of the last edit of every field
+	std::size_t collapsedEdits = 0;                                     // identical overrides merged into the edit before them
+	CreatedForms createdForms;
+	ConflictTracking conflictTracking = ConflictTracking::kFull;
 };
@@ -0,0 +1,298 @@
+#include "EditorIDIndex.h"
+
+#include "ConfigSchema.h"
+#include "PluginFile.h"
+
+namespace
+{
+	constexpr std::uint32_t cacheMagic = PluginFile::MakeSignature("SRDE");
+	constexpr std::uint32_t cacheVersion = 1;
+
+	// Little endian scalars and u16 length prefixed strings, truncated input sets failed and reads zeros
+	class CacheReader
+	{
+	public:
+		explicit CacheReader(std::string_view a_data) :
+			data(a_data)
+		{}
+
+		template <class T>
+		T Read()
+		{
+			T value{};
+			if (data.size() - offset < sizeof(T)) {
+				failed = true;
+				return value;
+			}
+			std::memcpy(&value, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return value;
+		}
+
+		std::string ReadString()
+		{
+			const auto size = Read<std::uint16_t>();
+			if (data.size() - offset < size) {
+				failed = true;
+				return {};
+			}
+			std::string result(data.substr(offset, size));
+			offset += size;
+			return result;
+		}
+
+		// A count of entries that take at least a_entrySize bytes each, more than the rest of the data can hold sets failed
+		// and reads zero so a corrupt count is never allocated for
+		std::uint32_t ReadCount(std::size_t a_entrySize)
+		{
+			const auto count = Read<std::uint32_t>();
+			if (count > (data.size() - offset) / a_entrySize) {
+				failed = true;
+				return 0;
+			}
+			return count;
+		}
+
+		bool failed = false;
+
+	private:
+		std::string_view data;
+		std::size_t offset = 0;
+	};
+
+	class CacheWriter
+	{
+	public:
+		template <class T>
+		void Write(T a_value)
+		{
+			data.append(reinterpret_cast<const char*>(&a_value), sizeof(T));
+		}
+
+		void WriteString(std::string_view a_string)
+		{
+			const auto size = static_cast<std::uint16_t>(std::min<std::size_t>(a_string.size(), 0xFFFF));
+			Write(size);
+			data.append(a_string.substr(0, size));
+		}
+
+		std::string data;
+	};
+
+	std::int64_t GetWriteTime(const std::filesystem::path& a_path, std::error_code& a_error)
+	{
+		return static_cast<std::int64_t>(std::filesystem::last_write_time(a_path, a_error).time_since_epoch().count());
+	}
+}
+
+std::string EditorIDIndex::Lowercase(std::string_view a_string)
+{
+	std::string result(a_string);
+	std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+	return result;
+}
+
+std::uint32_t EditorIDIndex::HashSignatures(std::span<const std::uint32_t> a_signatures)
+{
+	// FNV-1a, a cache written for other record types is thrown away as a whole
+	std::uint32_t hash = 2166136261u;
+	for (const auto signature : a_signatures) {
+		for (std::size_t i = 0; i < 4; i++) {
+			hash ^= (signature >> (i * 8)) & 0xFF;
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+std::vector<std::uint32_t> EditorIDIndex::GetSignatures()
+{
+	std::vector<std::uint32_t> result;
+	for (const auto& section : Schema::sections) {
+		result.push_back(PluginFile::MakeSignature(section.record));
+		for (const auto record : section.fieldRecords)
+			result.push_back(PluginFile::MakeSignature(record));
+	}
+	for (const auto record : Schema::descriptorRecords)
+		result.push_back(PluginFile::MakeSignature(record));
+	std::ranges::sort(result);
+	result.erase(std::ranges::unique(result).begin(), result.end());
+	return result;
+}
+
+std::vector<EditorIDIndex::PluginRecords> EditorIDIndex::ReadCache(const std::filesystem::path& a_path, std::uint32_t a_signatureHash)
+{
+	std::ifstream file(a_path, std::ios::binary);
+	if (!file.good())
+		return {};
+	const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	CacheReader reader(data);
+	if (reader.Read<std::uint32_t>() != cacheMagic || reader.Read<std::uint32_t>() != cacheVersion || reader.Read<std::uint32_t>() != a_signatureHash)
+		return {};
+
+	// Smallest plugin, owner and record entries, an empty string is its length alone
+	constexpr std::size_t pluginSize = 2 + 8 + 8 + 4 + 4;
+	constexpr std::size_t ownerSize = 2;
+	constexpr std::size_t recordSize = 4 + 4 + 4 + 2;
+
+	std::vector<PluginRecords> result(reader.ReadCount(pluginSize));
+	if (reader.failed)
+		return {};
+	for (auto& plugin : result) {
+		plugin.name = reader.ReadString();
+		plugin.size = reader.Read<std::uint64_t>();
+		plugin.time = reader.Read<std::int64_t>();
+		plugin.owners.resize(reader.ReadCount(ownerSize));
+		for (auto& owner : plugin.owners)
+			owner = reader.ReadString();
+		plugin.records.resize(reader.ReadCount(recordSize));
+		for (auto& record : plugin.records) {
+			record.signature = reader.Read<std::uint32_t>();
+			record.localID = reader.Read<std::uint32_t>();
+			record.owner = reader.Read<std::uint32_t>();
+			record.editorID = reader.ReadString();
+			if (record.owner >= plugin.owners.size())
+				reader.failed = true;
+		}
+		if (reader.failed)
+			return {};
+	}
+	return result;
+}
+
+bool EditorIDIndex::WriteCache(const std::filesystem::path& a_path, std::uint32_t a_signatureHash, std::span<const PluginRecords> a_plugins)
+{
+	CacheWriter writer;
+	writer.Write(cacheMagic);
+	writer.Write(cacheVersion);
+	writer.Write(a_signatureHash);
+	writer.Write(static_cast<std::uint32_t>(a_plugins.size()));
+	for (const auto& plugin : a_plugins) {
+		writer.WriteString(plugin.name);
+		writer.Write(plugin.size);
+		writer.Write(plugin.time);
+		writer.Write(static_cast<std::uint32_t>(plugin.owners.size()));
+		for (const auto& owner : plugin.owners)
+			writer.WriteString(owner);
+		writer.Write(static_cast<std::uint32_t>(plugin.records.size()));
+		for (const auto& record : plugin.records) {
+			writer.Write(record.signature);
+			writer.Write(record.localID);
+			writer.Write(record.owner);
+			writer.WriteString(record.editorID);
+		}
+	}
+
+	// Written next to the old cache and renamed over it, so a crash never leaves half a cache behind
+	auto temporary = a_path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(writer.data.data(), static_cast<std::streamsize>(writer.data.size()));
+		if (!file.good())
+			return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, a_path, error);
+	return !error;
+}
+
+void EditorIDIndex::Build(const std::filesystem::path& a_dataDirectory, std::span<const std::string> a_plugins, std::span<const std::uint32_t> a_signatures,
+	const std::filesystem::path& a_cachePath, std::vector<std::string>& a_errors)
+{
+	const auto signatureHash = HashSignatures(a_signatures);
+
+	std::unordered_map<std::string, PluginRecords> cache;
+	if (!a_cachePath.empty()) {
+		for (auto& plugin : ReadCache(a_cachePath, signatureHash)) {
+			auto key = Lowercase(plugin.name);
+			cache.emplace(std::move(key), std::move(plugin));
+		}
+	}
+
+	std::vector<PluginRecords> result(a_plugins.size());
+	std::atomic<std::size_t> next = 0;
+
+	const auto work = [&] {
+		for (auto i = next++; i < a_plugins.size(); i = next++) {
+			auto& plugin = result[i];
+			plugin.name = a_plugins[i];
+
+			const auto path = a_dataDirectory / plugin.name;
+			std::error_code error;
+			plugin.size = std::filesystem::file_size(path, error);
+			if (error)
+				continue;
+			plugin.time = GetWriteTime(path, error);
+			plugin.found = true;
+
+			if (const auto it = cache.find(Lowercase(plugin.name)); it != cache.end() && it->second.size == plugin.size && it->second.time == plugin.time) {
+				plugin.owners = std::move(it->second.owners);
+				plugin.records = std::move(it->second.records);
+				plugin.cached = true;
+				continue;
+			}
+
+			PluginFile file;
+			if (!file.Open(path, plugin.error))
+				continue;
+			plugin.owners = file.GetMasters();
+			plugin.owners.push_back(file.GetName());
+
+			const auto self = static_cast<std::uint32_t>(plugin.owners.size() - 1);
+			file.ForEachRecord(a_signatures, [&](const PluginFile::Record& a_record) {
+				if (a_record.editorID.empty())
+					return;
+				plugin.records.emplace_back(a_record.signature, file.GetOwner(a_record.formID).second, std::min(a_record.formID >> 24, self), std::string(a_record.editorID));
+			}, plugin.error);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	const auto workers = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), a_plugins.size());
+	for (std::size_t i = 1; i < workers; i++)
+		threads.emplace_back(work);
+	work();
+	for (auto& thread : threads)
+		thread.join();
+
+	// Merged in load order, a later plugin overrides an EditorID like it overrides the record
+	bool changed = cache.size() != a_plugins.size();
+	for (const auto& plugin : result) {
+		if (!plugin.found)
+			continue;
+		if (!plugin.error.empty())
+			a_errors.push_back("Failed to read EditorIDs of " + plugin.name + ": " + plugin.error);
+
+		stats.plugins++;
+		if (plugin.cached)
+			stats.cachedPlugins++;
+		else
+			changed = true;
+
+		std::vector<std::string_view> owners;
+		for (const auto& owner : plugin.owners)
+			owners.push_back(*plugins.insert(owner).first);
+		for (const auto& record : plugin.records)
+			entries.insert_or_assign(Lowercase(record.editorID), Entry{ owners[record.owner], record.localID, record.signature });
+	}
+	stats.editorIDs = entries.size();
+
+	if (!a_cachePath.empty() && changed) {
+		// Plugins that failed to read are left out so the next load tries them again
+		std::vector<PluginRecords> cached;
+		for (auto& plugin : result) {
+			if (plugin.found && plugin.error.empty())
+				cached.push_back(std::move(plugin));
+		}
+		if (!WriteCache(a_cachePath, signatureHash, cached))
+			a_errors.push_back("Failed to write the EditorID cache to " + a_cachePath.string());
+	}
+}
+
+const EditorIDIndex::Entry* EditorIDIndex::Find(std::string_view a_editorID) const
+{
+	const auto it = entries.find(Lowercase(a_editorID));
+	return it != entries.end() ? &it->second : nullptr;
+}
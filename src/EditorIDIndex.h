@@ -0,0 +1,70 @@
+#pragma once
+
+// EditorID -> plugin|local ID for the record types SRD edits, read from the plugin files themselves. The game drops
+// the EditorIDs of most form types once they are loaded, so this is the only way to resolve an EditorID of a weapon
+// or an armor without another plugin keeping them around. Shared with the offline tools.
+class EditorIDIndex
+{
+public:
+	struct Entry
+	{
+		std::string_view plugin;  // plugin that defines the form
+		std::uint32_t localID;
+		std::uint32_t signature;
+	};
+
+	struct Stats
+	{
+		std::size_t plugins = 0;
+		std::size_t cachedPlugins = 0;  // read from the cache instead of their plugin file
+		std::size_t editorIDs = 0;
+	};
+
+	// Record types of every section, field and sound descriptor of the config schema
+	static std::vector<std::uint32_t> GetSignatures();
+
+	// Scans a_plugins, in load order, for EditorIDs of a_signatures records, one plugin per thread. A later plugin
+	// wins an EditorID like in game. With a_cachePath, plugins whose size and write time match the cache are read from
+	// it instead, and the cache is rewritten when anything changed. Problems are added to a_errors, the plugins
+	// that fail keep whatever records were read before the problem.
+	void Build(const std::filesystem::path& a_dataDirectory, std::span<const std::string> a_plugins, std::span<const std::uint32_t> a_signatures,
+		const std::filesystem::path& a_cachePath, std::vector<std::string>& a_errors);
+
+	// Case-insensitive like the game's lookup
+	const Entry* Find(std::string_view a_editorID) const;
+
+	const Stats& GetStats() const { return stats; }
+	bool IsEmpty() const { return entries.empty(); }
+
+private:
+	// EditorIDs of one plugin file, as stored in the cache
+	struct PluginRecords
+	{
+		struct Record
+		{
+			std::uint32_t signature;
+			std::uint32_t localID;
+			std::uint32_t owner;  // index into owners
+			std::string editorID;
+		};
+
+		std::string name;
+		std::uint64_t size = 0;
+		std::int64_t time = 0;
+		std::vector<std::string> owners;  // masters, then the plugin itself
+		std::vector<Record> records;
+		std::string error;
+		bool found = false;
+		bool cached = false;
+	};
+
+	static std::string Lowercase(std::string_view a_string);
+	static std::uint32_t HashSignatures(std::span<const std::uint32_t> a_signatures);
+
+	static std::vector<PluginRecords> ReadCache(const std::filesystem::path& a_path, std::uint32_t a_signatureHash);
+	static bool WriteCache(const std::filesystem::path& a_path, std::uint32_t a_signatureHash, std::span<const PluginRecords> a_plugins);
+
+	std::unordered_set<std::string> plugins;                  // owns the names entries point to
+	std::unordered_map<std::string, Entry> entries;           // lowercase EditorID
+	Stats stats;
+};
@@ -1,5 +1,64 @@
 #include "FormUtil.h"
 
+namespace
+{
+	using MergedKey = std::pair<std::string_view, RE::FormID>;
+
+	struct MergedForm
+	{
+		std::string plugin;
+		RE::FormID localID;
+	};
+
+	struct MergedKeyHash
+	{
+		using is_transparent = void;
+
+		std::size_t operator()(const MergedKey& a_key) const
+		{
+			return std::hash<std::string_view>{}(a_key.first) ^ (std::hash<RE::FormID>{}(a_key.second) * 0x9E3779B97F4A7C15ull);
+		}
+		std::size_t operator()(const std::pair<std::string, RE::FormID>& a_key) const
+		{
+			return (*this)(MergedKey{ a_key.first, a_key.second });
+		}
+	};
+
+	struct MergedKeyEqual
+	{
+		using is_transparent = void;
+
+		bool operator()(const MergedKey& a_lhs, const MergedKey& a_rhs) const { return a_lhs == a_rhs; }
+	};
+
+	// Filled before forms are resolved and only read afterwards
+	std::unordered_map<std::pair<std::string, RE::FormID>, MergedForm, MergedKeyHash, MergedKeyEqual> mergedForms;
+
+	// Asks MergeMapper where a form ended up, the conversion is logged here so it shows once per pair
+	auto Translate(std::string_view a_plugin, RE::FormID a_localID) -> MergedForm
+	{
+		MergedForm result{ std::string(a_plugin), a_localID };
+		const auto [mergedModName, mergedFormID] = g_mergeMapperInterface->GetNewFormID(result.plugin.c_str(), a_localID);
+
+		std::string conversion_log = "";
+		if (a_localID && mergedFormID && a_localID != mergedFormID) {
+			conversion_log = std::format("0x{:x}->0x{:x}", a_localID, mergedFormID);
+			result.localID = mergedFormID;
+		}
+		const std::string mergedModString{ mergedModName ? mergedModName : "" };
+		if (!a_plugin.empty() && !mergedModString.empty() && a_plugin != mergedModString) {
+			if (conversion_log.empty())
+				conversion_log = std::format("{}->{}", a_plugin, mergedModString);
+			else
+				conversion_log = std::format("{}~{}->{}", conversion_log, a_plugin, mergedModString);
+			result.plugin = mergedModString;
+		}
+		if (!conversion_log.empty())
+			logger::debug("\t\tFound merged: {}", conversion_log);
+		return result;
+	}
+}
+
 auto FormUtil::GetFormFromIdentifier(const std::string& a_identifier) -> RE::TESForm*
 {
 	std::istringstream ss{ a_identifier };
@@ -9,27 +68,42 @@ auto FormUtil::GetFormFromIdentifier(const std::string& a_identifier) -> RE::TES
 	std::getline(ss, id);
 	RE::FormID relativeID;
 	std::istringstream{ id } >> std::hex >> relativeID;
+	return GetForm(plugin, relativeID);
+}
+
+auto FormUtil::GetForm(std::string_view a_plugin, RE::FormID a_localID) -> RE::TESForm*
+{
 	const auto dataHandler = RE::TESDataHandler::GetSingleton();
+	if (!dataHandler)
+		return nullptr;
+
 	if (g_mergeMapperInterface) {
-		const auto [mergedModName, mergedFormID] = g_mergeMapperInterface->GetNewFormID(plugin.c_str(), relativeID);
-		std::string conversion_log = "";
-		if (relativeID && mergedFormID && relativeID != mergedFormID) {
-			conversion_log = std::format("0x{:x}->0x{:x}", relativeID, mergedFormID);
-			relativeID = mergedFormID;
-		}
-		const std::string mergedModString{ mergedModName };
-		if (!(plugin.empty()) && !mergedModString.empty() && plugin != mergedModString)
-			{
-			if (conversion_log.empty())
-				conversion_log = std::format("{}->{}", plugin, mergedModString);
-			else
-				conversion_log = std::format("{}~{}->{}", conversion_log, plugin, mergedModString);
-			plugin = mergedModName;
-		}
-		if (!conversion_log.empty())
-			logger::debug("\t\tFound merged: {}", conversion_log);
+		if (const auto it = mergedForms.find(MergedKey{ a_plugin, a_localID }); it != mergedForms.end())
+			return dataHandler->LookupForm(it->second.localID, it->second.plugin);
+
+		const auto merged = Translate(a_plugin, a_localID);
+		return dataHandler->LookupForm(merged.localID, merged.plugin);
 	}
-	return dataHandler ? dataHandler->LookupForm(relativeID, plugin) : nullptr;
+	return dataHandler->LookupForm(a_localID, a_plugin);
+}
+
+void FormUtil::AddMergedForm(std::string_view a_plugin, RE::FormID a_localID)
+{
+	if (!g_mergeMapperInterface || mergedForms.contains(MergedKey{ a_plugin, a_localID }))
+		return;
+
+	auto merged = Translate(a_plugin, a_localID);
+	mergedForms.emplace(std::pair{ std::string(a_plugin), a_localID }, std::move(merged));
+}
+
+void FormUtil::ClearMergedForms()
+{
+	mergedForms.clear();
+}
+
+auto FormUtil::GetMergedFormCount() -> std::size_t
+{
+	return mergedForms.size();
 }
 
 auto FormUtil::GetIdentifierFromForm(const RE::TESForm* a_form) -> std::string
@@ -3,5 +3,12 @@
 namespace FormUtil
 {
 	auto GetFormFromIdentifier(const std::string& a_identifier) -> RE::TESForm*;
+	auto GetForm(std::string_view a_plugin, RE::FormID a_localID) -> RE::TESForm*;
 	auto GetIdentifierFromForm(const RE::TESForm* a_form) -> std::string;
+
+	// MergeMapper translation table, (plugin, local ID) -> (merged plugin, local ID). Every pair is queried once per
+	// load, GetForm then translates with a single lookup. Pairs that weren't added still go to MergeMapper directly.
+	void AddMergedForm(std::string_view a_plugin, RE::FormID a_localID);
+	void ClearMergedForms();
+	auto GetMergedFormCount() -> std::size_t;
 }
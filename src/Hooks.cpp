@@ -1,9 +1,39 @@
 #include "Hooks.h"
 
+#include <detours/detours.h>
+
+#include "Preloader.h"
+#include "SoundPools.h"
+
 namespace Hooks
 {
+	// Every sound the game plays from a descriptor is built here, so a pool proxy is swapped for one of its members
+	// right before the handle is made, and the preloader learns which sounds played. Hooked at the function entry:
+	// footsteps, weapons, magic, ambience and UI sounds each call it from their own sites, which differ between SE and
+	// AE, and SKSE's trampoline only rewrites call and jump instructions. Detours moves the prologue for us.
+	struct BuildSoundDataFromDescriptor
+	{
+		static bool thunk(RE::BSAudioManager* a_manager, RE::BSSoundHandle& a_handle, RE::BSISoundDescriptor* a_descriptor, std::uint32_t a_flags)
+		{
+			const auto descriptor = SoundPools::Pick(a_descriptor);
+			Preloader::RecordPlay(descriptor);
+			return func(a_manager, a_handle, descriptor, a_flags);
+		}
+		static inline decltype(&thunk) func;
+	};
+
 	void Hooks::Install()
 	{
+		BuildSoundDataFromDescriptor::func = reinterpret_cast<decltype(BuildSoundDataFromDescriptor::func)>(RELOCATION_ID(66404, 67666).address());
+
+		DetourTransactionBegin();
+		DetourUpdateThread(GetCurrentThread());
+		DetourAttach(reinterpret_cast<PVOID*>(&BuildSoundDataFromDescriptor::func), reinterpret_cast<PVOID>(BuildSoundDataFromDescriptor::thunk));
+		if (const auto error = DetourTransactionCommit(); error != NO_ERROR) {
+			logger::error("Failed to hook BSAudioManager::BuildSoundDataFromDescriptor ({}), sound pools only play their first sound", error);
+			return;
+		}
+
 		logger::info("Installed all hooks");
 	}
 }
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& a_rhs) noexcept
+{
+	*this = std::move(a_rhs);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& a_rhs) noexcept
+{
+	if (this != &a_rhs) {
+		Close();
+		data = std::exchange(a_rhs.data, nullptr);
+		size = std::exchange(a_rhs.size, 0);
+#ifdef _WIN32
+		file = std::exchange(a_rhs.file, nullptr);
+		mapping = std::exchange(a_rhs.mapping, nullptr);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::filesystem::path& a_path)
+{
+	Close();
+
+	file = CreateFileW(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		Close();
+		return false;
+	}
+
+	data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		Close();
+		return false;
+	}
+
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	data = nullptr;
+	size = 0;
+	mapping = nullptr;
+	file = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::filesystem::path& a_path)
+{
+	Close();
+
+	const int fd = ::open(a_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* view = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = static_cast<const std::byte*>(view);
+	size = static_cast<std::size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		::munmap(const_cast<std::byte*>(data), size);
+	data = nullptr;
+	size = 0;
+}
+
+#endif
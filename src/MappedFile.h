@@ -0,0 +1,28 @@
+#pragma once
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&& a_rhs) noexcept;
+	~MappedFile();
+
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile&& a_rhs) noexcept;
+
+	bool Open(const std::filesystem::path& a_path);
+	void Close();
+
+	bool IsOpen() const { return data != nullptr; }
+	std::span<const std::byte> GetData() const { return { data, size }; }
+
+private:
+	const std::byte* data = nullptr;
+	std::size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,203 @@
+#include "PluginFile.h"
+
+#include <zlib.h>
+
+namespace
+{
+	constexpr std::size_t headerSize = 24;
+	constexpr auto GRUP = PluginFile::MakeSignature("GRUP");
+	constexpr auto TES4 = PluginFile::MakeSignature("TES4");
+	constexpr auto EDID = PluginFile::MakeSignature("EDID");
+	constexpr auto MAST = PluginFile::MakeSignature("MAST");
+	constexpr auto XXXX = PluginFile::MakeSignature("XXXX");
+
+	// Record and group headers share this layout
+	struct Header
+	{
+		std::uint32_t signature;
+		std::uint32_t size;   // data size for records, total size including the header for groups
+		std::uint32_t flags;   // the record type of top level groups
+		std::uint32_t formID;  // the group type of groups
+	};
+
+	// Interior cell blocks and sub-blocks, the only nested groups that hold records SRD edits
+	constexpr std::uint32_t interiorCellBlock = 2;
+	constexpr std::uint32_t interiorCellSubBlock = 3;
+
+	auto ReadHeader(std::span<const std::byte> a_data, std::size_t a_offset) -> std::optional<Header>
+	{
+		if (a_offset > a_data.size() || a_data.size() - a_offset < headerSize)
+			return std::nullopt;
+		Header header;
+		std::memcpy(&header, a_data.data() + a_offset, sizeof(Header));
+		return header;
+	}
+
+	// Calls a_callback(signature, data) for every subrecord, false when the data is truncated
+	template <class F>
+	bool ForEachSubrecord(std::span<const std::byte> a_data, F&& a_callback)
+	{
+		std::size_t offset = 0;
+		std::uint32_t nextSize = 0;
+		while (offset + 6 <= a_data.size()) {
+			std::uint32_t signature;
+			std::uint16_t size;
+			std::memcpy(&signature, a_data.data() + offset, 4);
+			std::memcpy(&size, a_data.data() + offset + 4, 2);
+			offset += 6;
+
+			const std::size_t length = nextSize ? nextSize : size;
+			nextSize = 0;
+			if (length > a_data.size() - offset)
+				return false;
+
+			// XXXX carries the 32-bit size of a subrecord too large for the 16-bit field
+			if (signature == XXXX && length == 4)
+				std::memcpy(&nextSize, a_data.data() + offset, 4);
+			else if (!a_callback(signature, a_data.subspan(offset, length)))
+				return true;
+			offset += length;
+		}
+		return true;
+	}
+
+	auto ToStringView(std::span<const std::byte> a_data) -> std::string_view
+	{
+		std::string_view result{ reinterpret_cast<const char*>(a_data.data()), a_data.size() };
+		if (const auto end = result.find('\0'); end != std::string_view::npos)
+			result = result.substr(0, end);
+		return result;
+	}
+}
+
+std::string PluginFile::FormatSignature(std::uint32_t a_signature)
+{
+	std::string result(4, '\0');
+	for (std::size_t i = 0; i < 4; i++)
+		result[i] = static_cast<char>((a_signature >> (i * 8)) & 0xFF);
+	return result;
+}
+
+std::vector<std::string_view> PluginFile::GetStrings(std::span<const std::byte> a_subrecords, std::uint32_t a_signature)
+{
+	std::vector<std::string_view> result;
+	ForEachSubrecord(a_subrecords, [&](std::uint32_t a_subrecord, std::span<const std::byte> a_data) {
+		if (a_subrecord == a_signature)
+			result.push_back(ToStringView(a_data));
+		return true;
+	});
+	return result;
+}
+
+bool PluginFile::Open(const std::filesystem::path& a_path, std::string& a_error)
+{
+	name = a_path.filename().string();
+	masters.clear();
+
+	if (!file.Open(a_path)) {
+		a_error = "failed to map file";
+		return false;
+	}
+
+	const auto data = file.GetData();
+	const auto header = ReadHeader(data, 0);
+	if (!header || header->signature != TES4 || header->size > data.size() - headerSize) {
+		a_error = "not a plugin file";
+		return false;
+	}
+
+	flags = header->flags;
+	firstGroup = headerSize + header->size;
+
+	const bool valid = ForEachSubrecord(data.subspan(headerSize, header->size), [&](std::uint32_t a_signature, std::span<const std::byte> a_data) {
+		if (a_signature == MAST)
+			masters.emplace_back(ToStringView(a_data));
+		return true;
+	});
+	if (!valid) {
+		a_error = "plugin header is damaged";
+		return false;
+	}
+
+	return true;
+}
+
+bool PluginFile::ForEachRecord(std::span<const std::uint32_t> a_signatures, const std::function<void(const Record&)>& a_callback, std::string& a_error) const
+{
+	const auto data = file.GetData();
+	std::vector<std::byte> inflated;
+
+	const auto readRecord = [&](const Header& a_header, std::size_t a_offset) {
+		auto recordData = data.subspan(a_offset + headerSize, a_header.size);
+
+		if (a_header.flags & kCompressed) {
+			std::uint32_t size = 0;
+			if (recordData.size() < 4)
+				return false;
+			std::memcpy(&size, recordData.data(), 4);
+			inflated.resize(size);
+			uLongf inflatedSize = size;
+			if (uncompress(reinterpret_cast<Bytef*>(inflated.data()), &inflatedSize, reinterpret_cast<const Bytef*>(recordData.data() + 4), static_cast<uLong>(recordData.size() - 4)) != Z_OK)
+				return false;
+			recordData = { inflated.data(), static_cast<std::size_t>(inflatedSize) };
+		}
+
+		Record record{ a_header.signature, a_header.formID, {}, recordData };
+		ForEachSubrecord(recordData, [&](std::uint32_t a_signature, std::span<const std::byte> a_data) {
+			if (a_signature != EDID)
+				return true;
+			record.editorID = ToStringView(a_data);
+			return false;
+		});
+		a_callback(record);
+		return true;
+	};
+
+	std::size_t offset = firstGroup;
+	while (offset < data.size()) {
+		const auto group = ReadHeader(data, offset);
+		if (!group || group->signature != GRUP || group->size < headerSize || group->size > data.size() - offset) {
+			a_error = name + " is damaged at offset " + std::to_string(offset);
+			return false;
+		}
+
+		const auto end = offset + group->size;
+		if (std::ranges::find(a_signatures, group->flags) == a_signatures.end()) {
+			offset = end;
+			continue;
+		}
+
+		// Top level groups of the types SRD edits hold their records directly, nested groups are skipped except for the
+		// blocks interior cells are stored in. Entering one only means reading on past its header.
+		offset += headerSize;
+		while (offset < end) {
+			const auto header = ReadHeader(data.first(end), offset);
+			const bool isGroup = header && header->signature == GRUP;
+			if (!header || (isGroup ? header->size < headerSize || header->size > end - offset : header->size > end - offset - headerSize)) {
+				a_error = name + " is damaged at offset " + std::to_string(offset);
+				return false;
+			}
+			if (isGroup) {
+				const bool enter = header->formID == interiorCellBlock || header->formID == interiorCellSubBlock;
+				offset += enter ? headerSize : header->size;
+				continue;
+			}
+			if (!readRecord(*header, offset)) {
+				a_error = name + " has a damaged compressed record " + FormatSignature(header->signature) + " at offset " + std::to_string(offset);
+				return false;
+			}
+			offset += headerSize + header->size;
+		}
+	}
+
+	return true;
+}
+
+std::pair<std::string_view, std::uint32_t> PluginFile::GetOwner(std::uint32_t a_formID) const
+{
+	const auto index = a_formID >> 24;
+	const auto localID = a_formID & 0xFFFFFF;
+	if (index < masters.size())
+		return { masters[index], localID };
+	return { name, localID };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "MappedFile.h"
+
+// Reads records of a plugin file (.esm/.esp/.esl) without the game. Only what SRD needs: the master list, form IDs,
+// record types and EditorIDs, and the raw subrecords for anything else. Top level groups of other record types are
+// skipped by size without being walked.
+class PluginFile
+{
+public:
+	enum Flag : std::uint32_t
+	{
+		kMaster = 1 << 0,
+		kLocalized = 1 << 7,
+		kLight = 1 << 9,
+		kCompressed = 1 << 18  // record flag, data is a zlib stream
+	};
+
+	struct Record
+	{
+		std::uint32_t signature;
+		std::uint32_t formID;       // as stored, the top byte indexes GetMasters() or is the file itself
+		std::string_view editorID;  // empty when the record has none, only valid during the callback
+		std::span<const std::byte> subrecords;  // inflated, only valid during the callback
+	};
+
+	static constexpr std::uint32_t MakeSignature(std::string_view a_signature)
+	{
+		std::uint32_t result = 0;
+		for (std::size_t i = 0; i < 4 && i < a_signature.size(); i++)
+			result |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(a_signature[i])) << (i * 8);
+		return result;
+	}
+
+	static std::string FormatSignature(std::uint32_t a_signature);
+
+	// Every a_signature subrecord of a record's subrecords read as a zero terminated string
+	static std::vector<std::string_view> GetStrings(std::span<const std::byte> a_subrecords, std::uint32_t a_signature);
+
+	bool Open(const std::filesystem::path& a_path, std::string& a_error);
+
+	const std::string& GetName() const { return name; }
+	const std::vector<std::string>& GetMasters() const { return masters; }
+	bool IsMaster() const { return flags & kMaster; }
+	bool IsLight() const { return (flags & kLight) || std::filesystem::path(name).extension() == ".esl"; }
+
+	// Calls a_callback for every record in the top level groups of the given types, interior cells in their blocks included
+	bool ForEachRecord(std::span<const std::uint32_t> a_signatures, const std::function<void(const Record&)>& a_callback, std::string& a_error) const;
+
+	// Splits a stored form ID into the plugin that defines the form and its local ID
+	std::pair<std::string_view, std::uint32_t> GetOwner(std::uint32_t a_formID) const;
+
+private:
+	MappedFile file;
+	std::string name;
+	std::vector<std::string> masters;
+	std::uint32_t flags = 0;
+	std::size_t firstGroup = 0;
+};
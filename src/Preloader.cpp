@@ -0,0 +1,292 @@
+#include "Preloader.h"
+
+#include "Archive.h"
+#include "PluginFile.h"
+
+namespace
+{
+	// Lowercase with backslashes, the form archive entries are stored in
+	std::string NormalizePath(std::string_view a_path)
+	{
+		std::string result(a_path);
+		std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return a_char == '/' ? '\\' : static_cast<char>(std::tolower(a_char)); });
+		return result;
+	}
+
+	// Archives the game mounts: the ini lists first, then the archive named after each plugin
+	std::vector<std::filesystem::path> GetArchivePaths()
+	{
+		std::vector<std::filesystem::path> result;
+		if (const auto ini = RE::INISettingCollection::GetSingleton()) {
+			for (const auto name : { "sResourceArchiveList:Archive"sv, "sResourceArchiveList2:Archive"sv }) {
+				const auto setting = ini->GetSetting(name);
+				if (!setting || setting->GetType() != RE::Setting::Type::kString || !setting->GetString())
+					continue;
+				for (const auto part : std::string_view(setting->GetString()) | std::views::split(',')) {
+					std::string_view archive(part.begin(), part.end());
+					archive.remove_prefix(std::min(archive.find_first_not_of(' '), archive.size()));
+					archive = archive.substr(0, archive.find_last_not_of(' ') + 1);
+					if (!archive.empty())
+						result.push_back(std::filesystem::path(R"(Data\)") / archive);
+				}
+			}
+		}
+		for (const auto file : RE::TESDataHandler::GetSingleton()->files) {
+			if (!file)
+				continue;
+			auto archive = std::filesystem::path(R"(Data\)") / file->GetFilename();
+			archive.replace_extension(".bsa");
+			result.push_back(std::move(archive));
+		}
+		return result;
+	}
+}
+
+void Preloader::Add(const RE::BGSSoundDescriptorForm* a_sound, Priority a_priority, std::span<const std::string> a_files)
+{
+	if (!a_sound)
+		return;
+
+	const auto [it, inserted] = entryIndex.try_emplace(a_sound, entries.size());
+	if (!inserted) {
+		auto& entry = entries[it->second];
+		entry.priority = std::min(entry.priority, a_priority);
+		return;
+	}
+
+	auto& entry = entries.emplace_back();
+	entry.sound = a_sound;
+	entry.priority = a_priority;
+	for (const auto& file : a_files)
+		entry.files.push_back(NormalizePath(file));
+
+	// Config descriptors have no file, plugin descriptors are looked up by the form ID their plugins store
+	const auto owner = a_sound->GetFile(0);
+	const auto plugin = a_sound->GetFile(-1);
+	if (a_files.empty() && owner && plugin) {
+		entry.plugin = plugin->GetFilename();
+		entry.owner = NormalizePath(owner->GetFilename());
+		entry.localID = a_sound->GetFormID() & (owner->IsLight() ? 0xFFF : 0xFFFFFF);
+	}
+}
+
+void Preloader::Start(std::uint64_t a_budget)
+{
+	if (started) {
+		ReportHitRate();
+		return;
+	}
+	if (entries.empty() || !a_budget)
+		return;
+	started = true;
+
+	RaisePlayerSounds();
+
+	auto index = std::make_unique<Index>();
+	index->sounds.reserve(entries.size());
+	for (const auto& entry : entries)
+		index->sounds.push_back(entry.sound);
+	std::ranges::sort(index->sounds);
+	index->states = std::make_unique<std::atomic<std::uint8_t>[]>(index->sounds.size());
+	current.store(index.get(), std::memory_order_release);
+	published = std::move(index);
+
+	worker = std::jthread([this, archives = GetArchivePaths(), a_budget](std::stop_token a_stop) mutable {
+		Read(std::move(archives), a_budget, a_stop);
+	});
+}
+
+void Preloader::RecordPlay(const RE::BSISoundDescriptor* a_descriptor)
+{
+	const auto index = current.load(std::memory_order_acquire);
+	if (!index)
+		return;
+
+	const auto it = std::ranges::lower_bound(index->sounds, a_descriptor);
+	if (it == index->sounds.end() || *it != a_descriptor)
+		return;
+
+	const auto previous = index->states[it - index->sounds.begin()].fetch_or(kPlayed, std::memory_order_relaxed);
+	if (previous & kPlayed)
+		return;
+	stats.plays.fetch_add(1, std::memory_order_relaxed);
+	if (previous & kRead)
+		stats.hits.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Preloader::RaisePlayerSounds()
+{
+	std::vector<const RE::BSISoundDescriptor*> sounds;
+	const auto add = [&](const RE::BGSSoundDescriptorForm* a_sound) {
+		if (a_sound)
+			sounds.push_back(a_sound);
+	};
+
+	const auto player = RE::PlayerCharacter::GetSingleton();
+	if (!player)
+		return;
+
+	for (const bool leftHand : { false, true }) {
+		const auto object = player->GetEquippedObject(leftHand);
+		if (const auto weapon = object ? object->As<RE::TESObjectWEAP>() : nullptr) {
+			for (const auto sound : { weapon->attackSound, weapon->attackSound2D, weapon->attackLoopSound, weapon->attackFailSound, weapon->idleSound, weapon->equipSound, weapon->unequipSound })
+				add(sound);
+		}
+	}
+
+	const auto cell = player->GetParentCell();
+	const auto regionDataManager = RE::TESDataHandler::GetSingleton()->GetRegionDataManager();
+	if (const auto regions = cell && cell->IsExteriorCell() && regionDataManager ? cell->GetRegionList(false) : nullptr) {
+		for (const auto region : *regions) {
+			if (!region || !region->dataList)
+				continue;
+			for (const auto entry : region->dataList->regionDataList) {
+				if (!entry || entry->GetType() != RE::TESRegionData::Type::kSound)
+					continue;
+				if (const auto data = regionDataManager->AsRegionDataSound(entry)) {
+					for (const auto sound : data->sounds)
+						add(sound->sound);
+				}
+			}
+		}
+	}
+
+	if (const auto sky = RE::Sky::GetSingleton(); sky && sky->currentWeather) {
+		for (const auto entry : sky->currentWeather->sounds) {
+			if (entry)
+				add(RE::TESForm::LookupByID<RE::BGSSoundDescriptorForm>(entry->sound));
+		}
+	}
+
+	std::size_t raised = 0;
+	for (const auto sound : sounds) {
+		if (const auto it = entryIndex.find(sound); it != entryIndex.end() && entries[it->second].priority != Priority::kPlayer) {
+			entries[it->second].priority = Priority::kPlayer;
+			raised++;
+		}
+	}
+	logger::info("Preloading the sounds of {} distributed descriptors, {} of them around the player first", entries.size(), raised);
+}
+
+void Preloader::ResolvePluginFiles()
+{
+	constexpr auto SNDR = PluginFile::MakeSignature("SNDR");
+	constexpr auto ANAM = PluginFile::MakeSignature("ANAM");
+
+	// Every plugin is read once, for all the descriptors it has the last say on
+	std::map<std::string, std::map<std::pair<std::string, std::uint32_t>, Entry*>> plugins;
+	for (auto& entry : entries) {
+		if (!entry.plugin.empty())
+			plugins[entry.plugin].emplace(std::pair(entry.owner, entry.localID), &entry);
+	}
+
+	for (const auto& [plugin, pluginEntries] : plugins) {
+		PluginFile file;
+		std::string error;
+		if (!file.Open(std::filesystem::path(R"(Data\)") / plugin, error)) {
+			logger::warn("Failed to read the sound files of {}: {}", plugin, error);
+			continue;
+		}
+
+		file.ForEachRecord(std::span(&SNDR, 1), [&](const PluginFile::Record& a_record) {
+			const auto [owner, localID] = file.GetOwner(a_record.formID);
+			const auto it = pluginEntries.find({ NormalizePath(owner), localID });
+			if (it == pluginEntries.end())
+				return;
+			// Stored relative to Data\Sound
+			for (const auto path : PluginFile::GetStrings(a_record.subrecords, ANAM)) {
+				auto normalized = NormalizePath(path);
+				it->second->files.push_back(normalized.starts_with("sound\\") ? std::move(normalized) : "sound\\" + normalized);
+			}
+		}, error);
+		if (!error.empty())
+			logger::warn("Failed to read the sound files of {}: {}", plugin, error);
+	}
+}
+
+void Preloader::Read(std::vector<std::filesystem::path> a_archives, std::uint64_t a_budget, std::stop_token a_stop)
+{
+	using clock = std::chrono::steady_clock;
+	const auto begin = clock::now();
+
+	ResolvePluginFiles();
+
+	// Only the files to read are indexed. Later archives override earlier ones, loose files override both.
+	std::unordered_set<std::string_view> wanted;
+	for (const auto& entry : entries) {
+		for (const auto& file : entry.files)
+			wanted.insert(file);
+	}
+
+	std::vector<std::unique_ptr<Archive>> archives;
+	std::unordered_map<std::string, std::pair<const Archive*, const Archive::Entry*>> archived;
+	for (const auto& path : a_archives) {
+		auto archive = std::make_unique<Archive>();
+		std::string error;
+		if (!std::filesystem::exists(path) || !archive->Open(path, error))
+			continue;
+		for (const auto& entry : archive->GetEntries()) {
+			auto name = entry.folder.empty() || entry.folder == "." ? std::string(entry.name) : std::string(entry.folder) + '\\' + std::string(entry.name);
+			if (wanted.contains(name))
+				archived.insert_or_assign(std::move(name), std::pair(archive.get(), &entry));
+		}
+		archives.push_back(std::move(archive));
+	}
+
+	std::vector<std::size_t> order(entries.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::stable_sort(order, {}, [&](std::size_t a_entry) { return entries[a_entry].priority; });
+
+	const auto index = current.load(std::memory_order_acquire);
+	std::vector<char> chunk(1 << 16);
+	std::string data;
+	for (const auto i : order) {
+		if (a_stop.stop_requested())
+			return;
+
+		const auto& entry = entries[i];
+		if (stats.bytes.load(std::memory_order_relaxed) >= a_budget) {
+			stats.overBudget.fetch_add(entry.files.size(), std::memory_order_relaxed);
+			continue;
+		}
+
+		bool read = false;
+		for (const auto& file : entry.files) {
+			const auto loose = std::filesystem::path(R"(Data\)") / file;
+			if (std::ifstream stream(loose, std::ios::binary); stream.good()) {
+				while (stream.read(chunk.data(), chunk.size()) || stream.gcount())
+					stats.bytes.fetch_add(static_cast<std::uint64_t>(stream.gcount()), std::memory_order_relaxed);
+			} else if (const auto it = archived.find(file); it != archived.end()) {
+				std::string error;
+				if (!it->second.first->Read(*it->second.second, data, error)) {
+					stats.missing.fetch_add(1, std::memory_order_relaxed);
+					continue;
+				}
+				stats.bytes.fetch_add(data.size(), std::memory_order_relaxed);
+			} else {
+				stats.missing.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+			stats.files.fetch_add(1, std::memory_order_relaxed);
+			read = true;
+		}
+
+		if (read) {
+			const auto it = std::ranges::lower_bound(index->sounds, entry.sound);
+			index->states[it - index->sounds.begin()].fetch_or(kRead, std::memory_order_relaxed);
+		}
+	}
+
+	logger::info("Preloaded {} sound files ({:.1f} MB) in {} ms, {} missing, {} left over the budget",
+		stats.files.load(), static_cast<double>(stats.bytes.load()) / (1 << 20),
+		std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - begin).count(),
+		stats.missing.load(), stats.overBudget.load());
+}
+
+void Preloader::ReportHitRate() const
+{
+	const auto plays = stats.plays.load();
+	const auto hits = stats.hits.load();
+	if (plays)
+		logger::info("Preloaded sounds: {} of the {} distributed descriptors played so far had their files read first ({:.0f}%)", hits, plays, 100.0 * hits / plays);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Reads the sound files of the descriptors SRD distributed once, from a background thread, so that the first time one
+// plays doesn't wait on the disk. Files are read straight from their loose file or archive and left in the OS cache,
+// nothing is kept in memory. The sound hook reports first plays, which tells how many found their files already read.
+class Preloader
+{
+public:
+	// Read in this order until the budget runs out
+	enum class Priority : std::uint8_t
+	{
+		kPlayer,   // on the player's equipped items, current region or weather
+		kWeapons,  // played on every swing
+		kRegions,
+		kOther
+	};
+
+	// Called while configs apply, a descriptor keeps its highest priority. a_files are paths relative to Data, for
+	// descriptors created from configs. The files of plugin descriptors are read from the last plugin that overrides them.
+	void Add(const RE::BGSSoundDescriptorForm* a_sound, Priority a_priority, std::span<const std::string> a_files = {});
+
+	// Raises the sounds around the player and starts reading, at most a_budget bytes. Once the player is loaded,
+	// later calls only report the hit rate so far.
+	void Start(std::uint64_t a_budget);
+
+	bool IsEmpty() const { return entries.empty(); }
+
+	// From the sound hook, counts the first play of every distributed descriptor
+	static void RecordPlay(const RE::BSISoundDescriptor* a_descriptor);
+
+private:
+	struct Entry
+	{
+		const RE::BSISoundDescriptor* sound;
+		Priority priority;
+		std::vector<std::string> files;  // relative to Data, lowercase
+		std::string plugin;              // last plugin that overrides the descriptor, empty for config descriptors
+		std::string owner;               // plugin that defines it
+		std::uint32_t localID = 0;
+	};
+
+	enum State : std::uint8_t
+	{
+		kRead = 1 << 0,
+		kPlayed = 1 << 1
+	};
+
+	// Distributed descriptors sorted by address, with their state at the same index
+	struct Index
+	{
+		std::vector<const RE::BSISoundDescriptor*> sounds;
+		std::unique_ptr<std::atomic<std::uint8_t>[]> states;
+	};
+
+	struct Stats
+	{
+		std::atomic<std::size_t> files = 0;
+		std::atomic<std::uint64_t> bytes = 0;
+		std::atomic<std::size_t> missing = 0;     // not found loose or in any archive
+		std::atomic<std::size_t> overBudget = 0;  // left unread
+		std::atomic<std::size_t> plays = 0;       // first plays of distributed descriptors
+		std::atomic<std::size_t> hits = 0;        // of which had their files read
+	};
+
+	void RaisePlayerSounds();
+	void ResolvePluginFiles();
+	void Read(std::vector<std::filesystem::path> a_archives, std::uint64_t a_budget, std::stop_token a_stop);
+	void ReportHitRate() const;
+
+	std::vector<Entry> entries;
+	std::unordered_map<const RE::BSISoundDescriptor*, std::size_t> entryIndex;
+	bool started = false;
+	std::jthread worker;
+
+	static inline std::atomic<const Index*> current{ nullptr };
+	static inline std::unique_ptr<const Index> published;
+	static inline Stats stats;
+};
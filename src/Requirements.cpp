@@ -0,0 +1,245 @@
+#include "Requirements.h"
+
+#include <nlohmann/json.hpp>
+#include <yaml-cpp/yaml.h>
+
+namespace
+{
+	constexpr auto requirementsKey = "Requirements"sv;
+
+	auto SkipInsignificant(std::string_view a_text, std::size_t a_pos) -> std::size_t
+	{
+		while (a_pos < a_text.size()) {
+			const char c = a_text[a_pos];
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				a_pos++;
+			} else if (c == '/' && a_pos + 1 < a_text.size() && a_text[a_pos + 1] == '/') {
+				a_pos = a_text.find('\n', a_pos);
+				if (a_pos == std::string_view::npos)
+					return a_text.size();
+			} else if (c == '/' && a_pos + 1 < a_text.size() && a_text[a_pos + 1] == '*') {
+				a_pos = a_text.find("*/", a_pos + 2);
+				if (a_pos == std::string_view::npos)
+					return a_text.size();
+				a_pos += 2;
+			} else {
+				break;
+			}
+		}
+		return a_pos;
+	}
+
+	// a_pos is the opening quote, returns the position after the closing quote
+	auto SkipString(std::string_view a_text, std::size_t a_pos) -> std::size_t
+	{
+		for (a_pos++; a_pos < a_text.size(); a_pos++) {
+			if (a_text[a_pos] == '\\')
+				a_pos++;
+			else if (a_text[a_pos] == '"')
+				return a_pos + 1;
+		}
+		return std::string_view::npos;
+	}
+
+	// Skips a value of any type without building it, returns the position after it
+	auto SkipValue(std::string_view a_text, std::size_t a_pos) -> std::size_t
+	{
+		if (a_pos >= a_text.size())
+			return std::string_view::npos;
+
+		const char first = a_text[a_pos];
+		if (first == '"')
+			return SkipString(a_text, a_pos);
+
+		if (first != '{' && first != '[') {
+			while (a_pos < a_text.size() && !std::string_view(",}] \t\r\n/").contains(a_text[a_pos]))
+				a_pos++;
+			return a_pos;
+		}
+
+		std::size_t depth = 0;
+		while (a_pos < a_text.size()) {
+			a_pos = SkipInsignificant(a_text, a_pos);
+			if (a_pos >= a_text.size())
+				break;
+			const char c = a_text[a_pos];
+			if (c == '"') {
+				a_pos = SkipString(a_text, a_pos);
+				if (a_pos == std::string_view::npos)
+					break;
+				continue;
+			}
+			if (c == '{' || c == '[') {
+				depth++;
+			} else if (c == '}' || c == ']') {
+				if (--depth == 0)
+					return a_pos + 1;
+			}
+			a_pos++;
+		}
+		return std::string_view::npos;
+	}
+
+	auto ToRequirements(const nlohmann::json& a_value) -> std::optional<std::vector<std::string>>
+	{
+		std::vector<std::string> result;
+		if (a_value.is_null())
+			return result;
+		if (a_value.is_string()) {
+			result.emplace_back(a_value.get<std::string>());
+			return result;
+		}
+		if (!a_value.is_array())
+			return std::nullopt;
+		for (const auto& entry : a_value) {
+			if (!entry.is_string())
+				return std::nullopt;
+			result.emplace_back(entry.get<std::string>());
+		}
+		return result;
+	}
+
+	auto PeekJSON(std::string_view a_text) -> std::optional<std::vector<std::string>>
+	{
+		std::size_t pos = a_text.starts_with("\xEF\xBB\xBF"sv) ? 3 : 0;
+		pos = SkipInsignificant(a_text, pos);
+		if (pos >= a_text.size() || a_text[pos] != '{')
+			return std::nullopt;
+		pos++;
+
+		while (true) {
+			pos = SkipInsignificant(a_text, pos);
+			if (pos >= a_text.size())
+				return std::nullopt;
+			if (a_text[pos] == '}')
+				return std::vector<std::string>{};
+			if (a_text[pos] == ',') {
+				pos++;
+				continue;
+			}
+			if (a_text[pos] != '"')
+				return std::nullopt;
+
+			const auto keyEnd = SkipString(a_text, pos);
+			if (keyEnd == std::string_view::npos)
+				return std::nullopt;
+			const auto key = a_text.substr(pos + 1, keyEnd - pos - 2);
+
+			pos = SkipInsignificant(a_text, keyEnd);
+			if (pos >= a_text.size() || a_text[pos] != ':')
+				return std::nullopt;
+			pos = SkipInsignificant(a_text, pos + 1);
+
+			const auto valueEnd = SkipValue(a_text, pos);
+			if (valueEnd == std::string_view::npos)
+				return std::nullopt;
+
+			if (key == requirementsKey) {
+				const auto value = nlohmann::json::parse(a_text.substr(pos, valueEnd - pos), nullptr, false, true);
+				if (value.is_discarded())
+					return std::nullopt;
+				return ToRequirements(value);
+			}
+			pos = valueEnd;
+		}
+	}
+
+	auto IsRequirementsLine(std::string_view a_line) -> bool
+	{
+		for (const auto quote : { ""sv, "\""sv, "'"sv }) {
+			auto rest = a_line;
+			if (!rest.starts_with(quote))
+				continue;
+			rest.remove_prefix(quote.size());
+			if (!rest.starts_with(requirementsKey))
+				continue;
+			rest.remove_prefix(requirementsKey.size());
+			if (!rest.starts_with(quote))
+				continue;
+			rest.remove_prefix(quote.size());
+			const auto colon = rest.find_first_not_of(" \t");
+			if (colon != std::string_view::npos && rest[colon] == ':')
+				return true;
+		}
+		return false;
+	}
+
+	// Collects the "Requirements:" line and the indented or "- " lines that follow it, then loads only that snippet
+	auto PeekYAML(std::string_view a_text) -> std::optional<std::vector<std::string>>
+	{
+		std::size_t lineBegin = a_text.starts_with("\xEF\xBB\xBF"sv) ? 3 : 0;
+		std::size_t snippetBegin = std::string_view::npos;
+		std::size_t snippetEnd = a_text.size();
+		bool seenContent = false;
+
+		while (lineBegin < a_text.size()) {
+			auto lineEnd = a_text.find('\n', lineBegin);
+			if (lineEnd == std::string_view::npos)
+				lineEnd = a_text.size();
+			const auto line = a_text.substr(lineBegin, lineEnd - lineBegin);
+			const auto blank = line.find_first_not_of(" \t\r") == std::string_view::npos || line.starts_with('#');
+
+			if (snippetBegin != std::string_view::npos) {
+				const bool continuation = blank || line.starts_with(' ') || line.starts_with('\t') ||
+				                          (line.starts_with('-') && !line.starts_with("---"));
+				if (!continuation) {
+					snippetEnd = lineBegin;
+					break;
+				}
+			} else if (!blank && !line.starts_with("---") && !line.starts_with('%')) {
+				// Flow-style documents have no line structure to rely on
+				if (!seenContent && (line.starts_with('{') || line.starts_with('[')))
+					return std::nullopt;
+				seenContent = true;
+				if (IsRequirementsLine(line))
+					snippetBegin = lineBegin;
+			}
+			lineBegin = lineEnd + 1;
+		}
+
+		if (snippetBegin == std::string_view::npos)
+			return std::vector<std::string>{};
+
+		try {
+			const auto root = YAML::Load(std::string(a_text.substr(snippetBegin, snippetEnd - snippetBegin)));
+			const auto node = root[std::string(requirementsKey)];
+			std::vector<std::string> result;
+			if (!node || node.IsNull())
+				return result;
+			if (node.IsScalar()) {
+				result.emplace_back(node.as<std::string>());
+				return result;
+			}
+			if (!node.IsSequence())
+				return std::nullopt;
+			for (const auto& entry : node) {
+				if (!entry.IsScalar())
+					return std::nullopt;
+				result.emplace_back(entry.as<std::string>());
+			}
+			return result;
+		} catch (const YAML::Exception&) {
+			return std::nullopt;
+		}
+	}
+}
+
+auto Requirements::Peek(std::string_view a_text, bool a_yaml) -> std::optional<std::vector<std::string>>
+{
+	return a_yaml ? PeekYAML(a_text) : PeekJSON(a_text);
+}
+
+auto Requirements::GetMissing(const std::vector<std::string>& a_requirements, const std::function<bool(std::string_view)>& a_isLoaded) -> std::vector<std::string>
+{
+	std::vector<std::string> missing;
+	for (const auto& requirement : a_requirements) {
+		if (requirement.ends_with('!')) {
+			const auto modname = std::string_view(requirement).substr(0, requirement.size() - 1);
+			if (a_isLoaded(modname))
+				missing.emplace_back("NOT " + std::string(modname));
+		} else if (!a_isLoaded(requirement)) {
+			missing.emplace_back(requirement);
+		}
+	}
+	return missing;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace Requirements
+{
+	// Reads only the top-level "Requirements" key of a JSON/JSONC or YAML config.
+	// Returns an empty list when the key is absent and std::nullopt when it can't be read without a full parse.
+	auto Peek(std::string_view a_text, bool a_yaml) -> std::optional<std::vector<std::string>>;
+
+	// Returns the unmet entries of a requirement list, "Plugin.esp!" entries are reported as "NOT Plugin.esp"
+	auto GetMissing(const std::vector<std::string>& a_requirements, const std::function<bool(std::string_view)>& a_isLoaded) -> std::vector<std::string>;
+}
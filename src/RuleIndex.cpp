@@ -0,0 +1,106 @@
+#include "RuleIndex.h"
+
+bool RuleIndex::Add(const Pack::View& a_pack, const Pack::Record& a_record, const LookupKeywordFunc& a_lookupKeyword)
+{
+	auto& section = sections[static_cast<std::size_t>(a_record.section)];
+	const auto& source = a_pack.GetRule(a_record);
+
+	const auto addKeyword = [&](KeywordSet& a_set, const RE::BGSKeyword* a_keyword) {
+		const auto bit = section.keywordBits.try_emplace(a_keyword, static_cast<std::uint32_t>(section.keywordBits.size())).first->second;
+		if (a_set.size() <= bit / 64)
+			a_set.resize(bit / 64 + 1);
+		a_set[bit / 64] |= std::uint64_t(1) << (bit % 64);
+	};
+
+	Rule rule{ &a_record };
+
+	// A required keyword that doesn't exist can't be on any form, a missing excluded one never excludes anything
+	for (const auto keyword : a_pack.GetKeywords(source)) {
+		const auto form = a_lookupKeyword(a_pack, keyword);
+		if (!form)
+			return false;
+		addKeyword(rule.required, form);
+	}
+	for (const auto keyword : a_pack.GetExcludedKeywords(source)) {
+		if (const auto form = a_lookupKeyword(a_pack, keyword))
+			addKeyword(rule.excluded, form);
+	}
+
+	if (source.pluginCount) {
+		rule.plugins = std::make_unique<std::bitset<kFileSlots>>();
+		const auto dataHandler = RE::TESDataHandler::GetSingleton();
+		for (const auto plugin : a_pack.GetPlugins(source)) {
+			if (const auto slot = GetFileSlot(dataHandler->LookupModByName(a_pack.GetString(plugin))))
+				rule.plugins->set(*slot);
+		}
+		if (rule.plugins->none())
+			return false;
+	}
+
+	if (source.editorID != Pack::kNone)
+		rule.editorID = a_pack.GetString(source.editorID);
+
+	recordRules.emplace(&a_record, section.rules.size());
+	section.rules.push_back(std::move(rule));
+	return true;
+}
+
+std::span<RE::TESForm* const> RuleIndex::GetMatches(const Pack::Record& a_record) const
+{
+	const auto it = recordRules.find(&a_record);
+	if (it == recordRules.end())
+		return {};
+	return sections[static_cast<std::size_t>(a_record.section)].rules[it->second].matches;
+}
+
+std::optional<std::size_t> RuleIndex::GetFileSlot(const RE::TESFile* a_file)
+{
+	if (!a_file)
+		return std::nullopt;
+	if (a_file->IsLight())
+		return 0x100 + a_file->GetSmallFileCompileIndex();
+	if (a_file->GetCompileIndex() == 0xFF)
+		return std::nullopt;
+	return a_file->GetCompileIndex();
+}
+
+bool RuleIndex::MatchPattern(std::string_view a_pattern, std::string_view a_text)
+{
+	// Greedy wildcard match, backtracks to the last * on a mismatch
+	std::size_t p = 0, t = 0;
+	std::size_t star = std::string_view::npos, resume = 0;
+	while (t < a_text.size()) {
+		if (p < a_pattern.size() && a_pattern[p] == '*') {
+			star = p++;
+			resume = t;
+		} else if (p < a_pattern.size() && (a_pattern[p] == '?' || std::tolower(static_cast<unsigned char>(a_pattern[p])) == std::tolower(static_cast<unsigned char>(a_text[t])))) {
+			p++;
+			t++;
+		} else if (star != std::string_view::npos) {
+			p = star + 1;
+			t = ++resume;
+		} else {
+			return false;
+		}
+	}
+	while (p < a_pattern.size() && a_pattern[p] == '*')
+		p++;
+	return p == a_pattern.size();
+}
+
+bool RuleIndex::Matches(const Rule& a_rule, const KeywordSet& a_keywords, std::optional<std::size_t> a_slot, std::string_view a_editorID) const
+{
+	for (std::size_t i = 0; i < a_rule.required.size(); i++) {
+		if ((a_keywords[i] & a_rule.required[i]) != a_rule.required[i])
+			return false;
+	}
+	for (std::size_t i = 0; i < a_rule.excluded.size(); i++) {
+		if (a_keywords[i] & a_rule.excluded[i])
+			return false;
+	}
+	if (a_rule.plugins && (!a_slot || !a_rule.plugins->test(*a_slot)))
+		return false;
+	if (!a_rule.editorID.empty() && !MatchPattern(a_rule.editorID, a_editorID))
+		return false;
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ConfigPack.h"
+
+// Rule records compiled against the loaded game data. Keywords become bits of a per-section keyword set and plugins
+// become bits of a load order slot set, so every form array is walked once no matter how many rules target it.
+class RuleIndex
+{
+public:
+	using LookupKeywordFunc = std::function<RE::BGSKeyword*(const Pack::View&, std::uint32_t)>;
+
+	// Returns false when the rule can never match in this load order
+	bool Add(const Pack::View& a_pack, const Pack::Record& a_record, const LookupKeywordFunc& a_lookupKeyword);
+
+	// Walks the form array of T once and records the matches of every rule of a_section
+	template <class T>
+	void Match(Schema::Section a_section);
+
+	std::span<RE::TESForm* const> GetMatches(const Pack::Record& a_record) const;
+
+	bool HasRules(Schema::Section a_section) const { return !sections[static_cast<std::size_t>(a_section)].rules.empty(); }
+
+private:
+	// 0x00-0xFD regular plugins by compile index, light plugins after them by small file compile index
+	static constexpr std::size_t kFileSlots = 0x100 + 0x1000;
+
+	using KeywordSet = std::vector<std::uint64_t>;
+
+	struct Rule
+	{
+		const Pack::Record* record;
+		KeywordSet required;
+		KeywordSet excluded;
+		std::unique_ptr<std::bitset<kFileSlots>> plugins;  // nullptr matches every plugin
+		std::string_view editorID;                          // empty matches every form
+		std::vector<RE::TESForm*> matches;
+	};
+
+	struct Section
+	{
+		std::vector<Rule> rules;
+		std::unordered_map<const RE::BGSKeyword*, std::uint32_t> keywordBits;
+	};
+
+	// Forms the rules of T are matched against
+	template <class T>
+	static auto& GetForms()
+	{
+		return RE::TESDataHandler::GetSingleton()->GetFormArray<T>();
+	}
+
+	static std::optional<std::size_t> GetFileSlot(const RE::TESFile* a_file);
+	static bool MatchPattern(std::string_view a_pattern, std::string_view a_text);
+
+	bool Matches(const Rule& a_rule, const KeywordSet& a_keywords, std::optional<std::size_t> a_slot, std::string_view a_editorID) const;
+
+	std::array<Section, static_cast<std::size_t>(Schema::Section::kTotal)> sections;
+	std::unordered_map<const Pack::Record*, std::size_t> recordRules;  // index into the rules of the record's section
+};
+
+// Cells have no form array, rules only see interior cells since exterior ones are loaded with their worldspace
+template <>
+inline auto& RuleIndex::GetForms<RE::TESObjectCELL>()
+{
+	return RE::TESDataHandler::GetSingleton()->interiorCells;
+}
+
+template <class T>
+void RuleIndex::Match(Schema::Section a_section)
+{
+	auto& section = sections[static_cast<std::size_t>(a_section)];
+	if (section.rules.empty())
+		return;
+
+	const bool needsEditorID = std::ranges::any_of(section.rules, [](const Rule& a_rule) { return !a_rule.editorID.empty(); });
+
+	KeywordSet keywords((section.keywordBits.size() + 63) / 64);
+	for (const auto form : GetForms<T>()) {
+		if (!form)
+			continue;
+
+		std::ranges::fill(keywords, 0);
+		if (const auto keywordForm = form->As<RE::BGSKeywordForm>(); keywordForm && !keywords.empty()) {
+			for (std::uint32_t i = 0; i < keywordForm->numKeywords; i++) {
+				if (const auto bit = section.keywordBits.find(keywordForm->keywords[i]); bit != section.keywordBits.end())
+					keywords[bit->second / 64] |= std::uint64_t(1) << (bit->second % 64);
+			}
+		}
+
+		const auto slot = GetFileSlot(form->GetFile(0));
+		const auto editorID = needsEditorID ? form->GetFormEditorID() : nullptr;
+
+		for (auto& rule : section.rules) {
+			if (Matches(rule, keywords, slot, editorID ? editorID : ""))
+				rule.matches.push_back(form);
+		}
+	}
+}
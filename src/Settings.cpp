@@ -0,0 +1,38 @@
+#include "Settings.h"
+
+#include <SimpleIni.h>
+
+void Settings::Load()
+{
+	const auto path = std::format(R"(Data\SKSE\Plugins\{}.ini)", Plugin::NAME);
+
+	CSimpleIniA ini;
+	ini.SetUnicode();
+	if (ini.LoadFile(path.c_str()) < 0)
+		return;
+
+	// Unknown names keep the default instead of turning logging off
+	const std::string level = ini.GetValue("Logging", "Level", "");
+	if (const auto parsed = spdlog::level::from_str(level); parsed != spdlog::level::off || level == "off")
+		logLevel = parsed;
+
+	const std::string_view tracking = ini.GetValue("Conflicts", "Tracking", "");
+	if (tracking == "none")
+		conflictTracking = ConflictTracking::kNone;
+	else if (tracking == "counts")
+		conflictTracking = ConflictTracking::kCounts;
+	else if (tracking == "full")
+		conflictTracking = ConflictTracking::kFull;
+
+	writeState = ini.GetBoolValue("Conflicts", "WriteState", writeState);
+
+	editorIDIndex = ini.GetBoolValue("EditorIDs", "Index", editorIDIndex);
+	editorIDCache = ini.GetBoolValue("EditorIDs", "Cache", editorIDCache);
+
+	const auto sliceBudget = ini.GetLongValue("Apply", "SliceBudget", 0);
+	applySliceBudget = std::chrono::milliseconds(std::max(sliceBudget, 0l));
+
+	// In MB
+	const auto preload = ini.GetLongValue("Preload", "Budget", static_cast<long>(preloadBudget >> 20));
+	preloadBudget = static_cast<std::uint64_t>(std::max(preload, 0l)) << 20;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ConflictTracking.h"
+
+// Options read from Data\SKSE\Plugins\SoundRecordDistributor.ini, every key is optional:
+//
+//   [Logging]
+//   Level = info  ; trace, debug, info, warn, error, critical or off. Per-config lines are logged at debug.
+//
+//   [Conflicts]
+//   Tracking = full  ; full prints the conflict summary, counts only logs edits per section, none records nothing.
+//                    ; Ignored by builds configured with SRD_CONFLICT_TRACKING.
+//   WriteState = false  ; also writes the final applied state next to the log, one line per field, with full tracking.
+//
+//   [Apply]
+//   SliceBudget = 0  ; milliseconds, above 0 applies configs in slices on the main thread during the main menu
+//                    ; instead of all at once at data load.
+//
+//   [EditorIDs]
+//   Index = true  ; reads the EditorIDs the game drops from the plugin files, so configs can still name those forms.
+//   Cache = true  ; keeps that index next to the log and only rereads plugins that changed.
+//
+//   [Preload]
+//   Budget = 64  ; MB of distributed sound files read in the background once a game loads, 0 turns preloading off.
+class Settings
+{
+public:
+	static Settings* GetSingleton()
+	{
+		static Settings singleton;
+		return &singleton;
+	}
+
+	void Load();
+
+	spdlog::level::level_enum logLevel = spdlog::level::info;
+	ConflictTracking conflictTracking = ConflictTracking::kFull;
+	bool writeState = false;
+	bool editorIDIndex = true;
+	bool editorIDCache = true;
+	std::chrono::milliseconds applySliceBudget{ 0 };
+	std::uint64_t preloadBudget = 64ull << 20;  // bytes, 0 turns preloading off
+
+private:
+	Settings() = default;
+};
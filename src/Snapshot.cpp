@@ -0,0 +1,64 @@
+#include "Snapshot.h"
+
+namespace
+{
+	// Owns every published snapshot, only the loader touches it
+	std::mutex publishLock;
+	std::vector<std::unique_ptr<const Snapshot>> published;
+}
+
+Snapshot::Snapshot(std::vector<Edit> a_edits, std::vector<std::string> a_files, std::size_t a_collapsed) :
+	edits(std::move(a_edits)),
+	files(std::move(a_files)),
+	collapsed(a_collapsed)
+{
+	std::ranges::stable_sort(edits, {}, [](const Edit& a_edit) { return std::tie(a_edit.form, a_edit.sound, a_edit.field); });
+}
+
+std::span<const Snapshot::Edit> Snapshot::GetEdits(RE::FormID a_form) const
+{
+	const auto [first, last] = std::ranges::equal_range(edits, a_form, {}, &Edit::form);
+	return { first, last };
+}
+
+std::vector<const Snapshot::Edit*> Snapshot::GetFinalState() const
+{
+	std::vector<const Edit*> result;
+	for (std::size_t i = 0; i < edits.size(); i++) {
+		const auto& edit = edits[i];
+		const bool last = i + 1 == edits.size() || std::tie(edit.form, edit.sound, edit.field) != std::tie(edits[i + 1].form, edits[i + 1].sound, edits[i + 1].field);
+		if (last)
+			result.push_back(&edit);
+	}
+	return result;
+}
+
+std::string Snapshot::FormatState(const Edit& a_edit) const
+{
+	return std::format("{:08X} {:08X} {} {:08X} {}\n", a_edit.form, a_edit.sound, a_edit.field, a_edit.value, files[a_edit.file]);
+}
+
+std::uint64_t Snapshot::GetDigest() const
+{
+	std::uint64_t hash = 0xCBF29CE484222325ull;
+	for (const auto edit : GetFinalState()) {
+		for (const auto c : FormatState(*edit)) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001B3ull;
+		}
+	}
+	return hash;
+}
+
+void Snapshot::WriteState(std::ostream& a_stream) const
+{
+	for (const auto edit : GetFinalState())
+		a_stream << FormatState(*edit);
+}
+
+void Snapshot::Publish(std::unique_ptr<const Snapshot> a_snapshot)
+{
+	std::scoped_lock guard(publishLock);
+	current.store(a_snapshot.get(), std::memory_order_release);
+	published.push_back(std::move(a_snapshot));
+}
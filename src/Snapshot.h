@@ -0,0 +1,55 @@
+#pragma once
+
+// Result of one load: which config edited which field of which form. A snapshot never changes once published, so
+// readers on any thread use it without locking. A reload publishes a new one with a single atomic store.
+class Snapshot
+{
+public:
+	// A form is keyed on its form ID. Pool proxies and config sound descriptors have none, they are keyed on their
+	// creation index with this bit set.
+	static constexpr std::uint64_t kCreated = 1ull << 32;
+
+	struct Edit
+	{
+		RE::FormID form;
+		std::uint64_t sound;     // key of the region or weather sound the edit belongs to, 0 otherwise
+		std::string_view field;  // points into Schema
+		std::uint32_t file;      // index into the snapshot's files
+		std::uint64_t value;     // key of the form the field was set to, 0 when cleared. Raw bits for region flags and
+		                         // chance and for weather sound types.
+	};
+
+	// Edits are ordered by form, sound and field, edits of one field stay in the order they were applied. a_edits
+	// come collapsed by DataStorage, a_collapsed is how many identical overrides it merged away.
+	Snapshot(std::vector<Edit> a_edits, std::vector<std::string> a_files, std::size_t a_collapsed);
+
+	std::span<const Edit> GetEdits() const { return edits; }
+	std::span<const Edit> GetEdits(RE::FormID a_form) const;
+	const std::string& GetFile(const Edit& a_edit) const { return files[a_edit.file]; }
+	std::size_t GetCollapsedCount() const { return collapsed; }
+
+	// Last edit of every form, sound and field, in snapshot order: the value the load left behind and the config
+	// that won
+	std::vector<const Edit*> GetFinalState() const;
+
+	// FNV-1a over the lines WriteState writes. It only depends on the final state, so any load path can be checked
+	// against the serial one by comparing digests, and diffed line by line when they differ.
+	std::uint64_t GetDigest() const;
+
+	// One "form sound field value file" line per final edit, IDs in hex
+	void WriteState(std::ostream& a_stream) const;
+
+	// Latest published snapshot, nullptr before the first load. Snapshots are kept for the whole session, so the
+	// pointer stays valid however long a reader holds it.
+	static const Snapshot* Get() { return current.load(std::memory_order_acquire); }
+	static void Publish(std::unique_ptr<const Snapshot> a_snapshot);
+
+private:
+	std::string FormatState(const Edit& a_edit) const;
+
+	std::vector<Edit> edits;
+	std::vector<std::string> files;
+	std::size_t collapsed = 0;  // identical overrides dropped
+
+	static inline std::atomic<const Snapshot*> current{ nullptr };
+};
@@ -0,0 +1,119 @@
+#include "SoundDescriptors.h"
+
+namespace
+{
+	// BGSStandardSoundDef has no constructor a plugin can call. Each one is built the way the game builds an empty one
+	// before reading its record: on the game's heap, so the form that owns it can free it like a loaded one, with every
+	// member zeroed, its vtable set and its array constructed. Playback defaults are the Creation Kit's.
+	RE::BGSStandardSoundDef* CreateSoundDef()
+	{
+		const auto sound = static_cast<RE::BGSStandardSoundDef*>(RE::malloc(sizeof(RE::BGSStandardSoundDef)));
+		if (!sound)
+			return nullptr;
+		std::memset(static_cast<void*>(sound), 0, sizeof(RE::BGSStandardSoundDef));
+		stl::emplace_vtable(sound);
+		std::construct_at(&sound->soundFiles);
+		sound->category = nullptr;
+		sound->outputModel = nullptr;
+		sound->soundCharacteristics.frequencyShift = 0;
+		sound->soundCharacteristics.frequencyVariance = 0;
+		sound->soundCharacteristics.priority = 128;
+		sound->soundCharacteristics.dbVariance = 0;
+		sound->soundCharacteristics.staticAttenuation = 0;
+		return sound;
+	}
+}
+
+std::string SoundDescriptors::Lowercase(std::string_view a_name)
+{
+	std::string result(a_name);
+	std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+	return result;
+}
+
+void SoundDescriptors::Create(std::span<const ConfigLoader::Config> a_configs, const LookupFunc& a_lookup)
+{
+	struct Definition
+	{
+		const ConfigLoader::Config* config;
+		const Pack::Descriptor* descriptor;
+		std::string name;
+	};
+
+	std::vector<Definition> definitions;
+	std::unordered_set<std::string> names;
+	for (const auto& config : a_configs) {
+		const auto& pack = *config.pack;
+		for (const auto& descriptor : pack.GetDescriptors(pack.configs[config.index])) {
+			auto name = Lowercase(pack.GetString(descriptor.name));
+			if (forms.contains(name) || !names.insert(name).second) {
+				logger::warn("Sound descriptor {} in {} is already defined, skipping it", pack.GetString(descriptor.name), config.filename);
+				continue;
+			}
+			definitions.emplace_back(&config, &descriptor, std::move(name));
+		}
+	}
+
+	if (definitions.empty())
+		return;
+
+	const auto factory = RE::IFormFactory::GetConcreteFormFactoryByType<RE::BGSSoundDescriptorForm>();
+	if (!factory) {
+		logger::error("Sound descriptor factory is missing, {} config sound descriptors are not created", definitions.size());
+		return;
+	}
+
+	forms.reserve(forms.size() + definitions.size());
+	std::size_t created = 0;
+	for (const auto& [config, descriptor, name] : definitions) {
+		const auto& pack = *config->pack;
+
+		const auto lookup = [&]<class T>(std::uint32_t a_identifier, T*& a_target, std::string_view a_problem) {
+			a_target = nullptr;
+			if (a_identifier == Pack::kNone)
+				return;
+			const auto form = a_lookup(pack, a_identifier);
+			a_target = form ? form->As<T>() : nullptr;
+			if (!a_target)
+				logger::warn("	Form {} of {} does not exist in {}, sound descriptor {} {}", pack.FormatIdentifier(a_identifier), typeid(T).name(), config->filename, pack.GetString(descriptor->name), a_problem);
+		};
+		// Bundles compiled before Output Model was required may still lack one
+		RE::BGSSoundOutput* outputModel;
+		lookup(descriptor->outputModel, outputModel, "is skipped"sv);
+		if (!outputModel) {
+			if (descriptor->outputModel == Pack::kNone)
+				logger::warn("	Sound descriptor {} in {} has no Output Model, skipping it", pack.GetString(descriptor->name), config->filename);
+			continue;
+		}
+
+		const auto sound = CreateSoundDef();
+		if (!sound) {
+			logger::error("Failed to allocate sound descriptor {}", pack.GetString(descriptor->name));
+			continue;
+		}
+		sound->outputModel = outputModel;
+		lookup(descriptor->category, sound->category, "is incomplete"sv);
+
+		// Stored in hundredths of a dB like the SNDR record
+		sound->soundCharacteristics.staticAttenuation = static_cast<std::uint16_t>(std::clamp(std::lround(descriptor->staticAttenuation * 100.0f), 0l, 0xFFFFl));
+
+		for (const auto file : pack.GetFiles(*descriptor)) {
+			RE::BSResource::ID id;
+			id.GenerateFromPath(std::string(pack.GetString(file)).c_str());
+			sound->soundFiles.push_back(id);
+		}
+
+		const auto form = factory->Create();
+		form->soundDescriptor = sound;
+		forms.emplace(name, form);
+		created++;
+	}
+
+	logger::info("Created {} sound descriptors", created);
+}
+
+RE::BGSSoundDescriptorForm* SoundDescriptors::Find(std::string_view a_name) const
+{
+	const auto it = forms.find(Lowercase(a_name));
+	return it != forms.end() ? it->second : nullptr;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ConfigLoader.h"
+
+// Sound descriptors defined by configs instead of plugins. Forms are created once at data load, each owning its sound
+// definition on the game's heap like a loaded one, and indexed by name so that any field can reference them like an
+// EditorID. A descriptor is only created when its output model resolves, the game plays every sound through one.
+class SoundDescriptors
+{
+public:
+	using LookupFunc = std::function<RE::TESForm*(const Pack::View&, std::uint32_t)>;
+
+	// Creates the descriptors of every loaded config. A name is defined once, later definitions are skipped.
+	void Create(std::span<const ConfigLoader::Config> a_configs, const LookupFunc& a_lookup);
+
+	// Case-insensitive like EditorIDs, nullptr when no config defines a_name
+	RE::BGSSoundDescriptorForm* Find(std::string_view a_name) const;
+
+	bool IsEmpty() const { return forms.empty(); }
+
+private:
+	static std::string Lowercase(std::string_view a_name);
+
+	std::unordered_map<std::string, RE::BGSSoundDescriptorForm*> forms;  // lowercase name
+};
@@ -0,0 +1,76 @@
+#include "SoundPools.h"
+
+RE::BGSSoundDescriptorForm* SoundPools::Add(std::span<RE::BGSSoundDescriptorForm* const> a_members, std::span<const float> a_weights)
+{
+	std::vector<RE::BSISoundDescriptor*> members;
+	std::vector<float> weights;
+	for (std::size_t i = 0; i < a_members.size(); i++) {
+		if (!a_members[i])
+			continue;
+		members.push_back(a_members[i]);
+		weights.push_back(a_weights[i]);
+	}
+	if (members.empty())
+		return nullptr;
+
+	auto [it, inserted] = pendingProxies.try_emplace({ members, weights }, nullptr);
+	if (!inserted)
+		return it->second;
+
+	const auto factory = RE::IFormFactory::GetConcreteFormFactoryByType<RE::BGSSoundDescriptorForm>();
+	if (!factory) {
+		pendingProxies.erase(it);
+		return nullptr;
+	}
+
+	const auto first = std::ranges::find_if(a_members, [](const RE::BGSSoundDescriptorForm* a_member) { return a_member != nullptr; });
+	const auto proxy = factory->Create();
+	proxy->soundDescriptor = (*first)->soundDescriptor;
+	it->second = proxy;
+
+	pending.emplace_back(proxy, AliasTable(weights), std::move(members));
+	return proxy;
+}
+
+void SoundPools::Publish()
+{
+	if (pending.empty())
+		return;
+
+	auto index = std::make_unique<Index>();
+	index->mask = std::bit_ceil(pending.size() * 2) - 1;
+	index->slots.assign(index->mask + 1, kEmpty);
+	index->pools = std::move(pending);
+	pending.clear();
+	pendingProxies.clear();
+
+	for (std::uint32_t i = 0; i < index->pools.size(); i++) {
+		auto slot = Hash(index->pools[i].proxy) & index->mask;
+		while (index->slots[slot] != kEmpty)
+			slot = (slot + 1) & index->mask;
+		index->slots[slot] = i;
+	}
+
+	current.store(index.get(), std::memory_order_release);
+	published.push_back(std::move(index));
+}
+
+RE::BSISoundDescriptor* SoundPools::Pick(RE::BSISoundDescriptor* a_descriptor)
+{
+	const auto index = current.load(std::memory_order_acquire);
+	if (!index || !a_descriptor)
+		return a_descriptor;
+
+	for (auto slot = Hash(a_descriptor) & index->mask;; slot = (slot + 1) & index->mask) {
+		const auto pool = index->slots[slot];
+		if (pool == kEmpty)
+			return a_descriptor;
+
+		const auto& entry = index->pools[pool];
+		if (entry.proxy == a_descriptor) {
+			// Every thread draws from its own generator, seeded from its stack address and the time it first played a pool
+			thread_local std::uint64_t state = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^ reinterpret_cast<std::uintptr_t>(&a_descriptor);
+			return entry.members[entry.table.Sample(AliasTable::NextRandom(state))];
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "AliasTable.h"
+
+// Weighted pools of sound descriptors. A field that takes a pool points at a proxy descriptor, and the sound hook
+// asks Pick for a member each time the game builds a sound from a descriptor. Pools are built once at data load and
+// published with one atomic store, so Pick never locks or allocates.
+class SoundPools
+{
+public:
+	// Creates the proxy of a pool, nullptr when none of a_members resolved. A proxy sounds like its first member
+	// wherever the game uses it without going through the hook. Pools with the same members and weights share one
+	// proxy, so fields set to equal pools hold equal values.
+	RE::BGSSoundDescriptorForm* Add(std::span<RE::BGSSoundDescriptorForm* const> a_members, std::span<const float> a_weights);
+
+	// Makes every pool added so far visible to Pick
+	void Publish();
+
+	std::size_t GetPendingCount() const { return pending.size(); }
+
+	// Member to play for a_descriptor, a_descriptor itself when it isn't a pool proxy
+	static RE::BSISoundDescriptor* Pick(RE::BSISoundDescriptor* a_descriptor);
+
+private:
+	struct Pool
+	{
+		const RE::BSISoundDescriptor* proxy;
+		AliasTable table;
+		std::vector<RE::BSISoundDescriptor*> members;
+	};
+
+	// Pools by proxy address, open addressing with at least half of the slots empty
+	struct Index
+	{
+		std::vector<Pool> pools;
+		std::vector<std::uint32_t> slots;  // index into pools
+		std::size_t mask;
+	};
+
+	static constexpr std::uint32_t kEmpty = 0xFFFFFFFF;
+
+	static std::size_t Hash(const RE::BSISoundDescriptor* a_proxy)
+	{
+		return static_cast<std::size_t>((reinterpret_cast<std::uintptr_t>(a_proxy) * 0x9E3779B97F4A7C15ull) >> 32);
+	}
+
+	std::vector<Pool> pending;
+	std::map<std::pair<std::vector<RE::BSISoundDescriptor*>, std::vector<float>>, RE::BGSSoundDescriptorForm*> pendingProxies;
+
+	static inline std::atomic<const Index*> current{ nullptr };
+	static inline std::vector<std::unique_ptr<const Index>> published;  // kept for the session, like snapshots
+};
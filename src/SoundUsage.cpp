@@ -0,0 +1,253 @@
+#include "SoundUsage.h"
+
+#include <execution>
+
+namespace
+{
+	using Section = Schema::Section;
+
+	struct Found
+	{
+		const RE::BGSSoundDescriptorForm* sound;
+		SoundUsage::Use use;
+	};
+
+	// Collects the sound fields of one section, one array of them per worker
+	class Collector
+	{
+	public:
+		explicit Collector(std::vector<Found>& a_found) :
+			found(a_found)
+		{}
+
+		template <class Field>
+		void Add(RE::TESForm* a_form, Section a_section, Field a_field, RE::BGSSoundDescriptorForm*& a_slot)
+		{
+			if (a_slot)
+				found.push_back({ a_slot, { a_form, &a_slot, nullptr, a_section, static_cast<std::uint16_t>(a_field) } });
+		}
+
+		void AddPickUpPutDown(RE::TESForm* a_form, Section a_section)
+		{
+			using Field = Schema::PickUpPutDownField;
+			if (const auto sounds = a_form->As<RE::BGSPickupPutdownSounds>()) {
+				Add(a_form, a_section, Field::kPickUp, sounds->pickupSound);
+				Add(a_form, a_section, Field::kPutDown, sounds->putdownSound);
+			}
+		}
+
+		std::vector<Found>& found;
+	};
+
+	template <class T, class F>
+	void ForEachForm(F&& a_function)
+	{
+		for (const auto form : RE::TESDataHandler::GetSingleton()->GetFormArray<T>()) {
+			if (form)
+				a_function(form);
+		}
+	}
+
+	void CollectRegions(Collector& a_collector)
+	{
+		const auto regionDataManager = RE::TESDataHandler::GetSingleton()->GetRegionDataManager();
+		if (!regionDataManager)
+			return;
+
+		ForEachForm<RE::TESRegion>([&](RE::TESRegion* a_form) {
+			if (!a_form->dataList)
+				return;
+			for (const auto entry : a_form->dataList->regionDataList) {
+				if (!entry || entry->GetType() != RE::TESRegionData::Type::kSound)
+					continue;
+				if (const auto data = regionDataManager->AsRegionDataSound(entry)) {
+					for (const auto sound : data->sounds)
+						a_collector.Add(a_form, Section::kRegions, Schema::RegionField::kRDSA, sound->sound);
+				}
+			}
+		});
+	}
+
+	void CollectWeapons(Collector& a_collector)
+	{
+		using Field = Schema::WeaponField;
+		ForEachForm<RE::TESObjectWEAP>([&](RE::TESObjectWEAP* a_form) {
+			a_collector.AddPickUpPutDown(a_form, Section::kWeapons);
+			a_collector.Add(a_form, Section::kWeapons, Field::kAttack, a_form->attackSound);
+			a_collector.Add(a_form, Section::kWeapons, Field::kAttack2D, a_form->attackSound2D);
+			a_collector.Add(a_form, Section::kWeapons, Field::kAttackLoop, a_form->attackLoopSound);
+			a_collector.Add(a_form, Section::kWeapons, Field::kAttackFail, a_form->attackFailSound);
+			a_collector.Add(a_form, Section::kWeapons, Field::kIdle, a_form->idleSound);
+			a_collector.Add(a_form, Section::kWeapons, Field::kEquip, a_form->equipSound);
+			a_collector.Add(a_form, Section::kWeapons, Field::kUnequip, a_form->unequipSound);
+		});
+	}
+
+	void CollectMagicEffects(Collector& a_collector)
+	{
+		// Field keys follow RE::MagicSystem::SoundID
+		ForEachForm<RE::EffectSetting>([&](RE::EffectSetting* a_form) {
+			for (auto& sound : a_form->effectSounds)
+				a_collector.Add(a_form, Section::kMagicEffects, sound.id, sound.sound);
+		});
+	}
+
+	template <class T, Section S>
+	void CollectPickUpPutDown(Collector& a_collector)
+	{
+		ForEachForm<T>([&](T* a_form) { a_collector.AddPickUpPutDown(a_form, S); });
+	}
+
+	void CollectProjectiles(Collector& a_collector)
+	{
+		using Field = Schema::ProjectileField;
+		ForEachForm<RE::BGSProjectile>([&](RE::BGSProjectile* a_form) {
+			a_collector.Add(a_form, Section::kProjectiles, Field::kActive, a_form->data.activeSoundLoop);
+			a_collector.Add(a_form, Section::kProjectiles, Field::kCountdown, a_form->data.countdownSound);
+			a_collector.Add(a_form, Section::kProjectiles, Field::kDeactivate, a_form->data.deactivateSound);
+		});
+	}
+
+	void CollectExplosions(Collector& a_collector)
+	{
+		using Field = Schema::ExplosionField;
+		ForEachForm<RE::BGSExplosion>([&](RE::BGSExplosion* a_form) {
+			a_collector.Add(a_form, Section::kExplosions, Field::kInterior, a_form->data.sound1);
+			a_collector.Add(a_form, Section::kExplosions, Field::kExterior, a_form->data.sound2);
+		});
+	}
+
+	void CollectEffectShaders(Collector& a_collector)
+	{
+		ForEachForm<RE::TESEffectShader>([&](RE::TESEffectShader* a_form) {
+			a_collector.Add(a_form, Section::kEffectShaders, Schema::EffectShaderField::kAmbient, a_form->data.ambientSound);
+		});
+	}
+
+	void CollectIngestibles(Collector& a_collector)
+	{
+		ForEachForm<RE::AlchemyItem>([&](RE::AlchemyItem* a_form) {
+			a_collector.Add(a_form, Section::kIngestibles, Schema::IngestibleField::kConsume, a_form->data.consumptionSound);
+		});
+	}
+
+	void CollectAcousticSpaces(Collector& a_collector)
+	{
+		ForEachForm<RE::BGSAcousticSpace>([&](RE::BGSAcousticSpace* a_form) {
+			a_collector.Add(a_form, Section::kAcousticSpaces, Schema::AcousticSpaceField::kAmbient, a_form->loopingSound);
+		});
+	}
+
+	void CollectActivators(Collector& a_collector)
+	{
+		using Field = Schema::ActivatorField;
+		ForEachForm<RE::TESObjectACTI>([&](RE::TESObjectACTI* a_form) {
+			a_collector.Add(a_form, Section::kActivators, Field::kLoop, a_form->soundLoop);
+			a_collector.Add(a_form, Section::kActivators, Field::kActivate, a_form->soundActivate);
+		});
+	}
+
+	void CollectDoors(Collector& a_collector)
+	{
+		using Field = Schema::DoorField;
+		ForEachForm<RE::TESObjectDOOR>([&](RE::TESObjectDOOR* a_form) {
+			a_collector.Add(a_form, Section::kDoors, Field::kOpen, a_form->openSound);
+			a_collector.Add(a_form, Section::kDoors, Field::kClose, a_form->closeSound);
+			a_collector.Add(a_form, Section::kDoors, Field::kLoop, a_form->loopSound);
+		});
+	}
+
+	void CollectContainers(Collector& a_collector)
+	{
+		using Field = Schema::ContainerField;
+		ForEachForm<RE::TESObjectCONT>([&](RE::TESObjectCONT* a_form) {
+			a_collector.Add(a_form, Section::kContainers, Field::kOpen, a_form->openSound);
+			a_collector.Add(a_form, Section::kContainers, Field::kClose, a_form->closeSound);
+		});
+	}
+
+	void CollectWater(Collector& a_collector)
+	{
+		ForEachForm<RE::TESWaterForm>([&](RE::TESWaterForm* a_form) {
+			a_collector.Add(a_form, Section::kWater, Schema::WaterField::kSound, a_form->waterSound);
+		});
+	}
+
+	void CollectWeathers(Collector& a_collector)
+	{
+		// Field keys follow the weather sound types
+		ForEachForm<RE::TESWeather>([&](RE::TESWeather* a_form) {
+			for (const auto entry : a_form->sounds) {
+				if (const auto sound = entry ? RE::TESForm::LookupByID<RE::BGSSoundDescriptorForm>(entry->sound) : nullptr)
+					a_collector.found.push_back({ sound, { a_form, nullptr, &entry->sound, Section::kWeathers, static_cast<std::uint16_t>(entry->type) } });
+			}
+		});
+	}
+
+	// Sections without sound descriptor fields (armor addons and cells) have no collector
+	constexpr void (*collectors[])(Collector&) = {
+		CollectRegions,
+		CollectWeapons,
+		CollectMagicEffects,
+		CollectPickUpPutDown<RE::TESObjectARMO, Section::kArmors>,
+		CollectPickUpPutDown<RE::TESObjectMISC, Section::kMiscItems>,
+		CollectPickUpPutDown<RE::TESSoulGem, Section::kSoulGems>,
+		CollectProjectiles,
+		CollectExplosions,
+		CollectEffectShaders,
+		CollectIngestibles,
+		CollectAcousticSpaces,
+		CollectActivators,
+		CollectDoors,
+		CollectContainers,
+		CollectWater,
+		CollectWeathers
+	};
+}
+
+void SoundUsage::Build()
+{
+	struct Part
+	{
+		void (*collect)(Collector&);
+		std::vector<Found> found;
+	};
+
+	std::vector<Part> parts;
+	for (const auto collect : collectors)
+		parts.push_back({ collect, {} });
+
+	std::for_each(std::execution::par, parts.begin(), parts.end(), [](Part& a_part) {
+		Collector collector(a_part.found);
+		a_part.collect(collector);
+	});
+
+	// Counted first so every sound's uses land next to each other without sorting
+	ranges.clear();
+	for (const auto& part : parts) {
+		for (const auto& found : part.found)
+			ranges[found.sound].second++;
+	}
+	std::uint32_t next = 0;
+	for (auto& [sound, range] : ranges) {
+		range.first = next;
+		next += range.second;
+		range.second = 0;
+	}
+
+	uses.resize(next);
+	for (const auto& part : parts) {
+		for (const auto& found : part.found) {
+			auto& range = ranges[found.sound];
+			uses[range.first + range.second++] = found.use;
+		}
+	}
+}
+
+std::span<const SoundUsage::Use> SoundUsage::GetUses(const RE::BGSSoundDescriptorForm* a_sound) const
+{
+	const auto it = ranges.find(a_sound);
+	if (it == ranges.end())
+		return {};
+	return { uses.data() + it->second.first, it->second.second };
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ConfigSchema.h"
+
+// Every place a sound descriptor is used by the record types SRD edits, by descriptor. Built in one parallel pass over
+// the data handler's form arrays, so a Replace entry rewrites the uses of a sound without scanning any form.
+class SoundUsage
+{
+public:
+	struct Use
+	{
+		RE::TESForm* form;
+		RE::BGSSoundDescriptorForm** slot;  // nullptr for weather sounds, which store a form ID instead
+		RE::FormID* formID;
+		Schema::Section section;
+		std::uint16_t field;  // key of the section's field
+	};
+
+	void Build();
+
+	std::span<const Use> GetUses(const RE::BGSSoundDescriptorForm* a_sound) const;
+
+	std::size_t GetSize() const { return uses.size(); }
+	std::size_t GetSoundCount() const { return ranges.size(); }
+
+private:
+	std::vector<Use> uses;  // grouped by sound
+	std::unordered_map<const RE::BGSSoundDescriptorForm*, std::pair<std::uint32_t, std::uint32_t>> ranges;  // first use, count
+};
@@ -0,0 +1,97 @@
+#include "Trace.h"
+
+#ifdef SRD_TRACE
+namespace
+{
+	struct Event
+	{
+		std::string_view name;
+		std::string detail;
+		std::int64_t begin;
+		std::int64_t end;
+	};
+
+	struct ThreadBuffer
+	{
+		std::uint32_t tid;
+		std::vector<Event> events;
+	};
+
+	// Buffers are owned here, so threads of the parallel pool may exit without losing their spans
+	std::mutex registryLock;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = [] {
+			std::scoped_lock guard(registryLock);
+			auto& result = registry.emplace_back(std::make_unique<ThreadBuffer>());
+			result->tid = static_cast<std::uint32_t>(registry.size());
+			return result.get();
+		}();
+		return *buffer;
+	}
+
+	std::int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+Trace::Span::Span(std::string_view a_name, std::string a_detail) :
+	name(a_name),
+	detail(std::move(a_detail)),
+	begin(Now())
+{
+}
+
+Trace::Span::~Span()
+{
+	const auto end = Now();
+	GetThreadBuffer().events.emplace_back(name, std::move(detail), begin, end);
+}
+
+void Trace::Reset()
+{
+	GetThreadBuffer();  // registers the loading thread first, it shows as Main
+
+	std::scoped_lock guard(registryLock);
+	for (auto& buffer : registry)
+		buffer->events.clear();
+}
+
+bool Trace::Dump(const std::filesystem::path& a_path)
+{
+	std::scoped_lock guard(registryLock);
+
+	std::int64_t origin = std::numeric_limits<std::int64_t>::max();
+	for (const auto& buffer : registry) {
+		for (const auto& event : buffer->events)
+			origin = std::min(origin, event.begin);
+	}
+
+	auto events = nlohmann::json::array();
+	for (const auto& buffer : registry) {
+		if (buffer->events.empty())
+			continue;
+
+		events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", buffer->tid },
+			{ "args", { { "name", buffer->tid == 1 ? "Main" : "Worker " + std::to_string(buffer->tid) } } } });
+
+		// Timestamps are microseconds, fractions keep sub-microsecond spans visible
+		for (const auto& event : buffer->events) {
+			nlohmann::json entry{ { "name", std::string(event.name) }, { "cat", "srd" }, { "ph", "X" }, { "pid", 1 }, { "tid", buffer->tid },
+				{ "ts", static_cast<double>(event.begin - origin) / 1000.0 }, { "dur", static_cast<double>(event.end - event.begin) / 1000.0 } };
+			if (!event.detail.empty())
+				entry["args"] = { { "detail", event.detail } };
+			events.push_back(std::move(entry));
+		}
+	}
+
+	std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+	if (!file.good())
+		return false;
+	file << nlohmann::json{ { "traceEvents", std::move(events) }, { "displayTimeUnit", "ms" } }.dump();
+	return file.good();
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+// Scoped spans over the load pipeline, dumped as Chrome trace-event JSON that chrome://tracing and Perfetto open.
+// Only active in builds configured with SRD_TRACE, otherwise SRD_TRACE_SCOPE compiles to nothing and its
+// arguments aren't evaluated.
+namespace Trace
+{
+#ifdef SRD_TRACE
+	inline constexpr bool enabled = true;
+#else
+	inline constexpr bool enabled = false;
+#endif
+
+	// Records [construction, destruction) into the calling thread's buffer
+	class Span
+	{
+	public:
+		explicit Span(std::string_view a_name, std::string a_detail = {});
+		~Span();
+
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+	private:
+		std::string_view name;  // must outlive the trace, literals or Schema names
+		std::string detail;
+		std::int64_t begin;
+	};
+
+	// Drops every recorded span, call while no span is open
+	void Reset();
+
+	// Writes every recorded span, call once the traced work is done
+	bool Dump(const std::filesystem::path& a_path);
+}
+
+#ifdef SRD_TRACE
+#	define SRD_TRACE_CONCAT_IMPL(a, b) a##b
+#	define SRD_TRACE_CONCAT(a, b) SRD_TRACE_CONCAT_IMPL(a, b)
+#	define SRD_TRACE_SCOPE(...) const Trace::Span SRD_TRACE_CONCAT(traceSpan, __LINE__)(__VA_ARGS__)
+#else
+#	define SRD_TRACE_SCOPE(...) static_cast<void>(0)
+
+inline void Trace::Reset() {}
+inline bool Trace::Dump(const std::filesystem::path&) { return false; }
+#endif
@@ -0,0 +1,67 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+{
+	const auto workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	for (std::size_t i = 0; i < workers; i++)
+		threads.emplace_back(&WorkerPool::Work, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::scoped_lock guard(lock);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void WorkerPool::Run(std::size_t a_count, const std::function<void(std::size_t)>& a_function)
+{
+	if (a_count == 0)
+		return;
+
+	{
+		std::scoped_lock guard(lock);
+		function = &a_function;
+		count = a_count;
+		next = 0;
+		generation++;
+	}
+	if (a_count > 1)
+		wake.notify_all();
+
+	for (auto i = next++; i < a_count; i = next++)
+		a_function(i);
+
+	// Workers that wake after this see no loop and go back to waiting
+	std::unique_lock guard(lock);
+	done.wait(guard, [&] { return busy == 0; });
+	function = nullptr;
+}
+
+void WorkerPool::Work()
+{
+	std::uint64_t seen = 0;
+	std::unique_lock guard(lock);
+	for (;;) {
+		wake.wait(guard, [&] { return stop || generation != seen; });
+		if (stop)
+			return;
+		seen = generation;
+		if (!function)
+			continue;
+
+		const auto current = function;
+		const auto total = count;
+		busy++;
+		guard.unlock();
+		for (auto i = next++; i < total; i = next++)
+			(*current)(i);
+		guard.lock();
+		if (--busy == 0)
+			done.notify_all();
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+
+// A fixed set of threads that runs one index loop at a time. The threads are started once and wait between loops, so a
+// caller running many short loops doesn't pay for creating and joining threads each time. The calling thread takes
+// part in every loop. Shared with the offline tools.
+class WorkerPool
+{
+public:
+	// Up to one thread per core, the calling thread included
+	WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	~WorkerPool();
+
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Calls a_function(i) for every i below a_count on the pool and returns once every call has returned. Not reentrant.
+	void Run(std::size_t a_count, const std::function<void(std::size_t)>& a_function);
+
+private:
+	void Work();
+
+	std::vector<std::thread> threads;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// The current loop, only changed under lock while no worker is inside it
+	const std::function<void(std::size_t)>* function = nullptr;
+	std::size_t count = 0;
+	std::atomic<std::size_t> next = 0;
+	std::uint64_t generation = 0;  // bumped for every loop, workers wake when it changes
+	std::size_t busy = 0;          // workers inside the current loop
+	bool stop = false;
+};
@@ -1,5 +1,7 @@
+#include "AsyncLogSink.h"
 #include "DataStorage.h"
 #include "Hooks.h"
+#include "Settings.h"
 
 void MessageHandler(SKSE::MessagingInterface::Message* a_msg)
 {
@@ -18,6 +20,17 @@ void MessageHandler(SKSE::MessagingInterface::Message* a_msg)
 		break;
 	case SKSE::MessagingInterface::kDataLoaded:
 		DataStorage::GetSingleton()->LoadConfigs();
+		break;
+	case SKSE::MessagingInterface::kPreLoadGame:
+		DataStorage::GetSingleton()->FinishApply();
+		break;
+	case SKSE::MessagingInterface::kNewGame:
+		DataStorage::GetSingleton()->FinishApply();
+		DataStorage::GetSingleton()->StartPreload();
+		break;
+	case SKSE::MessagingInterface::kPostLoadGame:
+		DataStorage::GetSingleton()->StartPreload();
+		break;
 	}
 }
 void Init()
@@ -25,8 +38,27 @@ void Init()
 	SKSE::GetMessagingInterface()->RegisterListener(MessageHandler);
 }
 
+#ifdef NDEBUG
+LPTOP_LEVEL_EXCEPTION_FILTER previousCrashFilter = nullptr;
+
+// Writes out queued log lines when the game crashes, the writer thread may not get to run again. Only exceptions
+// nobody handled get here, then the filter that was installed before runs as usual.
+LONG WINAPI FlushLogOnCrash(EXCEPTION_POINTERS* a_info)
+{
+	static std::atomic_flag flushed;
+
+	if (!flushed.test_and_set()) {
+		if (const auto sink = std::dynamic_pointer_cast<AsyncLogSink>(spdlog::default_logger()->sinks().front()))
+			sink->FlushFromCrash();
+	}
+	return previousCrashFilter ? previousCrashFilter(a_info) : EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
 void InitializeLog()
 {
+	Settings::GetSingleton()->Load();
+
 #ifndef NDEBUG
 	auto sink = std::make_shared<spdlog::sinks::msvc_sink_mt>();
 #else
@@ -36,18 +68,19 @@ void InitializeLog()
 	}
 
 	*path /= std::format("{}.log"sv, Plugin::NAME);
-	auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(path->string(), true);
+	auto sink = std::make_shared<AsyncLogSink>(*path);
+	previousCrashFilter = SetUnhandledExceptionFilter(FlushLogOnCrash);
 #endif
 
 #ifndef NDEBUG
 	const auto level = spdlog::level::trace;
 #else
-	const auto level = spdlog::level::trace;
+	const auto level = Settings::GetSingleton()->logLevel;
 #endif
 
 	auto log = std::make_shared<spdlog::logger>("global log"s, std::move(sink));
 	log->set_level(level);
-	log->flush_on(level);
+	log->flush_on(spdlog::level::err);
 
 	spdlog::set_default_logger(std::move(log));
 	spdlog::set_pattern("%v");
@@ -67,6 +100,7 @@ EXTERN_C [[maybe_unused]] __declspec(dllexport) bool SKSEAPI SKSEPlugin_Load(con
 	SKSE::Init(a_skse);
 
 	Init();
+	Hooks::Install();
 
 	return true;
 }
@@ -0,0 +1,100 @@
+#include "FormIndex.h"
+
+#include "PluginFile.h"
+
+std::string FormIndex::Lowercase(std::string_view a_string)
+{
+	std::string result(a_string);
+	std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+	return result;
+}
+
+std::string FormIndex::MakeKey(std::string_view a_plugin, std::uint32_t a_localID) const
+{
+	auto key = Lowercase(a_plugin);
+	if (lightPlugins.contains(key))
+		a_localID &= 0xFFF;
+	else
+		a_localID &= 0xFFFFFF;
+	key += '|';
+	key += std::to_string(a_localID);
+	return key;
+}
+
+void FormIndex::Add(Form a_form)
+{
+	auto key = MakeKey(a_form.plugin, a_form.localID);
+	auto [it, inserted] = formIDs.try_emplace(std::move(key), forms.size());
+	if (inserted) {
+		forms.push_back(std::move(a_form));
+	} else if (!a_form.editorID.empty()) {
+		auto& form = forms[it->second];
+		if (const auto previous = editorIDs.find(Lowercase(form.editorID)); previous != editorIDs.end() && previous->second == it->second)
+			editorIDs.erase(previous);
+		form.editorID = std::move(a_form.editorID);
+	}
+
+	const auto& form = forms[it->second];
+	if (!form.editorID.empty())
+		editorIDs.insert_or_assign(Lowercase(form.editorID), it->second);
+}
+
+void FormIndex::SetLight(std::string_view a_plugin)
+{
+	lightPlugins.insert(Lowercase(a_plugin));
+}
+
+bool FormIndex::LoadManifest(const std::filesystem::path& a_path, std::string& a_error)
+{
+	std::ifstream file(a_path);
+	if (!file.good()) {
+		a_error = "failed to open " + a_path.string();
+		return false;
+	}
+
+	std::string line;
+	std::size_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line.starts_with('#'))
+			continue;
+
+		std::vector<std::string_view> columns;
+		std::string_view rest = line;
+		while (true) {
+			const auto comma = rest.find(',');
+			columns.push_back(rest.substr(0, comma));
+			if (comma == std::string_view::npos)
+				break;
+			rest.remove_prefix(comma + 1);
+		}
+
+		auto id = columns.size() == 4 ? columns[1] : std::string_view{};
+		if (id.starts_with("0x") || id.starts_with("0X"))
+			id.remove_prefix(2);
+		std::uint32_t localID = 0;
+		const auto [end, ec] = std::from_chars(id.data(), id.data() + id.size(), localID, 16);
+		if (columns.size() != 4 || id.empty() || ec != std::errc{} || end != id.data() + id.size() || columns[3].size() != 4) {
+			a_error = a_path.filename().string() + " line " + std::to_string(lineNumber) + ": expected Plugin,0xLocalID,EditorID,SIGN";
+			return false;
+		}
+
+		Add({ PluginFile::MakeSignature(columns[3]), std::string(columns[0]), localID, std::string(columns[2]) });
+	}
+
+	return true;
+}
+
+const FormIndex::Form* FormIndex::Find(std::string_view a_plugin, std::uint32_t a_localID) const
+{
+	const auto it = formIDs.find(MakeKey(a_plugin, a_localID));
+	return it != formIDs.end() ? &forms[it->second] : nullptr;
+}
+
+const FormIndex::Form* FormIndex::FindEditorID(std::string_view a_editorID) const
+{
+	const auto it = editorIDs.find(Lowercase(a_editorID));
+	return it != editorIDs.end() ? &forms[it->second] : nullptr;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Forms of a load order by plugin|local ID and by EditorID, the offline stand-in for TESDataHandler lookups.
+// Filled from the plugin files themselves or from a manifest exported from the game.
+class FormIndex
+{
+public:
+	struct Form
+	{
+		std::uint32_t signature;
+		std::string plugin;  // plugin that defines the form
+		std::uint32_t localID;
+		std::string editorID;
+	};
+
+	// Adds or overrides a form, forms must be added in load order so that the last EditorID wins like in game
+	void Add(Form a_form);
+	void SetLight(std::string_view a_plugin);
+
+	// Reads a manifest, one form per line as Plugin,0xLocalID,EditorID,SIGN. Empty lines and lines starting with # are skipped.
+	bool LoadManifest(const std::filesystem::path& a_path, std::string& a_error);
+
+	const Form* Find(std::string_view a_plugin, std::uint32_t a_localID) const;
+	const Form* FindEditorID(std::string_view a_editorID) const;
+
+	std::size_t GetSize() const { return forms.size(); }
+
+private:
+	static std::string Lowercase(std::string_view a_string);
+	std::string MakeKey(std::string_view a_plugin, std::uint32_t a_localID) const;
+
+	std::deque<Form> forms;
+	std::unordered_map<std::string, std::size_t> formIDs;
+	std::unordered_map<std::string, std::size_t> editorIDs;  // lowercase, the game looks EditorIDs up case-insensitively
+	std::unordered_set<std::string> lightPlugins;            // lowercase, light plugins only use 12 bits of the local ID
+};
@@ -0,0 +1,618 @@
+#include "AliasTable.h"
+#include "ConfigLoader.h"
+#include "ConfigPack.h"
+#include "EditorIDIndex.h"
+#include "FormIndex.h"
+#include "PluginFile.h"
+#include "tojson.hpp"
+
+namespace
+{
+	void PrintUsage()
+	{
+		std::cerr << "Usage:\n"
+					 "  srdtool compile <config directory> <output" << Schema::bundleExtension << ">\n"
+					 "  srdtool info <bundle" << Schema::bundleExtension << ">\n"
+					 "  srdtool conflicts <Data directory> <plugins.txt> [--manifest <forms.csv>] [--verbose]\n"
+					 "      Reports conflicting edits and unresolved forms for a load order. Forms are read from the plugin\n"
+					 "      files in the Data directory, or from a manifest with one Plugin,0xLocalID,EditorID,SIGN per line.\n"
+					 "  srdtool editorids <Data directory> <plugins.txt> [--cache <file>] [EditorID...]\n"
+					 "      Builds the EditorID index the plugin falls back to and looks the given EditorIDs up in it.\n"
+					 "  srdtool bench-pools [members] [selections]\n"
+					 "      Times sound pool selection and checks the drawn frequencies against the pool weights.\n";
+	}
+
+	bool ReadText(const std::filesystem::path& a_path, std::string& a_text)
+	{
+		std::ifstream file(a_path, std::ios::binary);
+		if (!file.good())
+			return false;
+		a_text.resize(std::filesystem::file_size(a_path));
+		file.read(a_text.data(), a_text.size());
+		return file.good();
+	}
+
+	void PrintSummary(const Pack::View& a_view)
+	{
+		std::cout << a_view.configs.size() << " configs, "
+				  << a_view.records.size() << " records, "
+				  << a_view.rules.size() << " rules, "
+				  << a_view.descriptors.size() << " sound descriptors, "
+				  << a_view.pools.size() << " sound pools, "
+				  << a_view.replacements.size() << " sound replacements, "
+				  << a_view.fields.size() << " fields, "
+				  << a_view.identifiers.size() << " unique identifiers, "
+				  << a_view.strings.size() << " strings\n";
+	}
+
+	int Compile(const std::filesystem::path& a_directory, const std::filesystem::path& a_output)
+	{
+		std::set<std::filesystem::path> paths;
+		for (const auto& entry : std::filesystem::directory_iterator(a_directory)) {
+			if (entry.is_regular_file() && Schema::IsConfigFile(entry.path()))
+				paths.insert(entry.path());
+		}
+
+		if (paths.empty()) {
+			std::cerr << "No configs ending with _SRD.json/.jsonc/.yaml in " << a_directory.string() << "\n";
+			return 1;
+		}
+
+		Pack::Builder builder;
+		std::size_t failed = 0;
+
+		for (const auto& path : paths) {
+			const auto filename = path.filename().string();
+			std::string text;
+			if (!ReadText(path, text)) {
+				std::cerr << "Failed to read " << filename << "\n";
+				failed++;
+				continue;
+			}
+
+			nlohmann::json data;
+			try {
+				if (path.extension() == ".yaml")
+					data = tojson::yaml2json(text);
+				else
+					data = nlohmann::json::parse(text, nullptr, true, true);
+			} catch (const std::exception& exc) {
+				std::cerr << "Failed to parse " << filename << "\n" << exc.what() << "\n";
+				failed++;
+				continue;
+			}
+
+			std::vector<std::string> errors;
+			builder.AddConfig(filename, data, errors);
+			for (const auto& error : errors)
+				std::cerr << error << "\n";
+			std::cout << "Compiled " << filename << "\n";
+		}
+
+		if (!builder.Write(a_output)) {
+			std::cerr << "Failed to write " << a_output.string() << "\n";
+			return 1;
+		}
+
+		std::cout << "Wrote " << a_output.string() << " (" << std::filesystem::file_size(a_output) << " bytes): ";
+		PrintSummary(builder.GetView());
+		return failed ? 1 : 0;
+	}
+
+	int Info(const std::filesystem::path& a_bundle)
+	{
+		Pack::Bundle bundle;
+		std::string error;
+		if (!bundle.Open(a_bundle, error)) {
+			std::cerr << "Failed to open " << a_bundle.string() << ": " << error << "\n";
+			return 1;
+		}
+
+		const auto& view = bundle.GetView();
+		PrintSummary(view);
+		for (const auto& config : view.configs) {
+			std::cout << "  " << view.GetString(config.name) << ": " << config.recordCount << " records";
+			if (config.descriptorCount)
+				std::cout << ", " << config.descriptorCount << " sound descriptors";
+			if (config.replacementCount)
+				std::cout << ", " << config.replacementCount << " sound replacements";
+			for (const auto& requirement : view.GetRequirements(config))
+				std::cout << ", requires " << requirement;
+			std::cout << "\n";
+		}
+		return 0;
+	}
+
+	// plugins.txt or loadorder.txt. When any line is marked active with *, only marked lines are loaded.
+	auto ReadPluginList(const std::filesystem::path& a_path) -> std::vector<std::string>
+	{
+		std::ifstream file(a_path);
+		std::vector<std::string> lines;
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (!line.empty() && !line.starts_with('#'))
+				lines.push_back(line);
+		}
+
+		const bool marked = std::ranges::any_of(lines, [](const std::string& a_line) { return a_line.starts_with('*'); });
+
+		// The base game masters are always loaded first and are usually missing from plugins.txt
+		std::vector<std::string> result{ "Skyrim.esm", "Update.esm", "Dawnguard.esm", "HearthFires.esm", "Dragonborn.esm" };
+		const auto isListed = [&](std::string_view a_plugin) {
+			return std::ranges::any_of(result, [&](const std::string& a_listed) {
+				return std::ranges::equal(a_listed, a_plugin, [](char a_lhs, char a_rhs) { return std::tolower(static_cast<unsigned char>(a_lhs)) == std::tolower(static_cast<unsigned char>(a_rhs)); });
+			});
+		};
+
+		for (auto& entry : lines) {
+			if (marked && !entry.starts_with('*'))
+				continue;
+			if (entry.starts_with('*'))
+				entry.erase(0, 1);
+			if (!isListed(entry))
+				result.push_back(std::move(entry));
+		}
+		return result;
+	}
+
+	struct PluginForms
+	{
+		std::string name;
+		bool found = false;
+		bool master = false;
+		bool light = false;
+		std::vector<FormIndex::Form> forms;
+		std::string error;
+	};
+
+	// Reads the plugins on every core, the results are added to the index in load order afterwards
+	auto ReadPlugins(const std::filesystem::path& a_dataDirectory, const std::vector<std::string>& a_plugins) -> std::vector<PluginForms>
+	{
+		const auto signatures = EditorIDIndex::GetSignatures();
+
+		std::vector<PluginForms> result(a_plugins.size());
+		std::atomic<std::size_t> next = 0;
+
+		const auto work = [&] {
+			for (auto i = next++; i < a_plugins.size(); i = next++) {
+				auto& plugin = result[i];
+				plugin.name = a_plugins[i];
+
+				const auto path = a_dataDirectory / plugin.name;
+				if (!std::filesystem::exists(path))
+					continue;
+				plugin.found = true;
+
+				PluginFile file;
+				if (!file.Open(path, plugin.error))
+					continue;
+				plugin.master = file.IsMaster();
+				plugin.light = file.IsLight();
+
+				file.ForEachRecord(signatures, [&](const PluginFile::Record& a_record) {
+					const auto [owner, localID] = file.GetOwner(a_record.formID);
+					plugin.forms.emplace_back(a_record.signature, std::string(owner), localID, std::string(a_record.editorID));
+				}, plugin.error);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		const auto workers = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), a_plugins.size());
+		for (std::size_t i = 1; i < workers; i++)
+			threads.emplace_back(work);
+		work();
+		for (auto& thread : threads)
+			thread.join();
+
+		return result;
+	}
+
+	auto FormatForm(const FormIndex::Form* a_form) -> std::string
+	{
+		if (!a_form)
+			return "NONE";
+		if (!a_form->editorID.empty())
+			return a_form->editorID;
+
+		char id[16];
+		const auto end = std::to_chars(std::begin(id), std::end(id), a_form->localID, 16).ptr;
+		std::string result(id, end);
+		std::ranges::transform(result, result.begin(), [](unsigned char a_char) { return static_cast<char>(std::toupper(a_char)); });
+		return result + "|" + a_form->plugin;
+	}
+
+	struct FormLess
+	{
+		bool operator()(const FormIndex::Form* a_lhs, const FormIndex::Form* a_rhs) const
+		{
+			if (!a_lhs || !a_rhs)
+				return !a_lhs && a_rhs;
+			return std::tie(a_lhs->plugin, a_lhs->localID) < std::tie(a_rhs->plugin, a_rhs->localID);
+		}
+	};
+
+	int Conflicts(std::span<const std::string_view> a_args)
+	{
+		using clock = std::chrono::steady_clock;
+		const auto begin = clock::now();
+
+		std::filesystem::path manifest;
+		bool verbose = false;
+		for (std::size_t i = 2; i < a_args.size(); i++) {
+			if (a_args[i] == "--manifest" && i + 1 < a_args.size())
+				manifest = a_args[++i];
+			else if (a_args[i] == "--verbose")
+				verbose = true;
+			else {
+				PrintUsage();
+				return 2;
+			}
+		}
+
+		const std::filesystem::path dataDirectory = a_args[0];
+		auto plugins = ReadPluginList(a_args[1]);
+		FormIndex index;
+
+		if (!manifest.empty()) {
+			std::string error;
+			if (!index.LoadManifest(manifest, error)) {
+				std::cerr << "Failed to read manifest: " << error << "\n";
+				return 1;
+			}
+			// Without headers the master flag is only known from the extension
+			std::ranges::stable_partition(plugins, [](const std::string& a_plugin) { return !a_plugin.ends_with(".esp"); });
+		} else {
+			auto pluginForms = ReadPlugins(dataDirectory, plugins);
+
+			// The game loads master flagged plugins first, whatever their position in the list
+			std::ranges::stable_partition(pluginForms, [](const PluginForms& a_plugin) { return a_plugin.master || a_plugin.light; });
+
+			plugins.clear();
+			for (auto& plugin : pluginForms) {
+				if (!plugin.found) {
+					std::cerr << "Plugin " << plugin.name << " is not in " << dataDirectory.string() << ", treating it as not loaded\n";
+					continue;
+				}
+				if (!plugin.error.empty())
+					std::cerr << "Failed to read " << plugin.name << ": " << plugin.error << "\n";
+				if (plugin.light)
+					index.SetLight(plugin.name);
+				for (auto& form : plugin.forms)
+					index.Add(std::move(form));
+				plugins.push_back(std::move(plugin.name));
+			}
+		}
+
+		const std::unordered_set<std::string> loaded(plugins.begin(), plugins.end());
+		ConfigLoader loader(
+			[&](std::string_view a_modname) { return loaded.contains(std::string(a_modname)); },
+			[&](ConfigLoader::Level a_level, const std::string& a_message) {
+				if (a_level == ConfigLoader::Level::kWarning || a_level == ConfigLoader::Level::kError)
+					std::cerr << a_message << "\n";
+				else if (verbose)
+					std::cout << a_message << "\n";
+			});
+
+		// Same archives as the plugin searches, the one named after each loaded plugin
+		std::vector<std::filesystem::path> archives;
+		for (const auto& plugin : plugins) {
+			auto archive = dataDirectory / plugin;
+			archive.replace_extension(".bsa");
+			if (std::filesystem::exists(archive))
+				archives.push_back(std::move(archive));
+		}
+
+		auto [generalConfigs, pluginConfigs] = loader.ScanConfigDirectory(dataDirectory, archives);
+		loader.ParseAllConfigs(loader.MatchPluginConfigs(pluginConfigs, plugins), generalConfigs);
+
+		std::set<std::string> unresolved;
+		const auto lookup = [&](std::uint32_t a_config, std::uint32_t a_identifier, std::string_view a_signature, std::string_view a_problem) -> const FormIndex::Form* {
+			const auto& config = loader.configs[a_config];
+			const auto& pack = *config.pack;
+			const auto& identifier = pack.identifiers[a_identifier];
+			const auto form = identifier.IsEditorID() ? index.FindEditorID(pack.GetString(identifier.value)) : index.Find(pack.GetString(identifier.plugin), identifier.value);
+			if (form && form->signature == PluginFile::MakeSignature(a_signature))
+				return form;
+			unresolved.insert(config.filename + ": form " + pack.FormatIdentifier(a_identifier) + " of " + std::string(a_signature) + " does not exist, " + std::string(a_problem));
+			return nullptr;
+		};
+
+		// Config sound descriptors are indexed like forms of a plugin named after their config, after every real plugin
+		// so that their names hide EditorIDs the same way they do in game
+		std::size_t descriptors = 0;
+		std::unordered_set<std::string> descriptorNames;
+		for (std::uint32_t i = 0; i < loader.configs.size(); i++) {
+			const auto& config = loader.configs[i];
+			const auto& pack = *config.pack;
+			for (const auto& descriptor : pack.GetDescriptors(pack.configs[config.index])) {
+				std::string name(pack.GetString(descriptor.name));
+				std::string key(name);
+				std::ranges::transform(key, key.begin(), [](unsigned char a_char) { return static_cast<char>(std::tolower(a_char)); });
+				if (!descriptorNames.insert(std::move(key)).second) {
+					std::cerr << "Sound descriptor " << name << " in " << config.filename << " is already defined, skipping it\n";
+					continue;
+				}
+
+				// Same as in game, a descriptor is only created when its output model resolves
+				if (descriptor.outputModel == Pack::kNone) {
+					std::cerr << "Sound descriptor " << name << " in " << config.filename << " has no Output Model, skipping it\n";
+					continue;
+				}
+				if (!lookup(i, descriptor.outputModel, Schema::descriptorRecords[1], "sound descriptor " + name + " is skipped"))
+					continue;
+				if (descriptor.category != Pack::kNone)
+					lookup(i, descriptor.category, Schema::descriptorRecords[0], "sound descriptor " + name + " is incomplete");
+				index.Add({ PluginFile::MakeSignature("SNDR"), config.filename, static_cast<std::uint32_t>(descriptors++), std::move(name) });
+			}
+		}
+
+		struct Writes
+		{
+			std::vector<std::string> files;
+			std::uint64_t value = 0;  // of the last file, form address or raw bits
+		};
+		std::map<const FormIndex::Form*, std::map<std::string, Writes>, FormLess> conflictMap;
+
+		// Same as in game: writing the value the field already holds is no conflict, it is only counted. The file takes
+		// the place of the one before it, so the last config that set the value is listed.
+		std::size_t collapsed = 0;
+		const auto record = [&](Writes& a_writes, const std::string& a_file, std::uint64_t a_value) {
+			if (!a_writes.files.empty() && a_writes.value == a_value) {
+				a_writes.files.back() = a_file;
+				collapsed++;
+				return;
+			}
+			a_writes.files.push_back(a_file);
+			a_writes.value = a_value;
+		};
+		const auto formValue = [](const FormIndex::Form* a_form) { return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(a_form)); };
+
+		// Which forms use a sound is unknown offline, a sound replaced by several configs is reported as a conflict of the sound
+		std::size_t replacements = 0;
+		for (std::uint32_t i = 0; i < loader.configs.size(); i++) {
+			const auto& config = loader.configs[i];
+			const auto& pack = *config.pack;
+			for (const auto& replacement : pack.GetReplacements(pack.configs[config.index])) {
+				const auto sound = lookup(i, replacement.sound, "SNDR", "skipping replacement");
+				const auto with = lookup(i, replacement.with, "SNDR", "skipping replacement");
+				if (!sound || !with)
+					continue;
+				replacements++;
+				record(conflictMap[sound]["Replace"], config.filename, formValue(with));
+			}
+		}
+
+		// Rules filter on keywords the plugin reader doesn't load, they are only evaluated in game
+		std::size_t rules = 0;
+		const auto sectionTasks = loader.PlanRecords<const FormIndex::Form*>(
+			[&](std::uint32_t a_config, const Pack::Record& a_record) {
+				return lookup(a_config, a_record.form, Schema::GetSection(a_record.section).record, "skipping entry");
+			},
+			[&](std::uint32_t, const Pack::Record&) {
+				rules++;
+				return std::span<const FormIndex::Form* const>{};
+			},
+			[](const FormIndex::Form* a_form) { return std::pair<std::string_view, std::uint32_t>(a_form->plugin, a_form->localID); });
+
+		std::map<const FormIndex::Form*, std::map<const FormIndex::Form*, std::map<std::string, Writes>, FormLess>, FormLess> conflictMapRegions;
+		std::size_t records = 0;
+
+		// Same rules as the apply step: a field counts as changed when it clears the value or its form resolves
+		for (std::size_t s = 0; s < sectionTasks.size(); s++) {
+			const auto section = static_cast<Schema::Section>(s);
+			for (const auto& task : sectionTasks[s]) {
+				records++;
+				const auto& config = loader.configs[task.config];
+				for (const auto& field : config.pack->GetFields(*task.record)) {
+					if (field.presence & Pack::Field::kPool) {
+						// A pool changes the field as soon as one of its sounds resolves. Pools with the same resolved
+						// members and weights share their proxy in game, so they are compared by a hash of both.
+						bool resolved = false;
+						std::uint64_t hash = 0xCBF29CE484222325ull;
+						for (const auto& member : config.pack->GetMembers(config.pack->pools[field.value])) {
+							const auto sound = lookup(task.config, member.sound, "SNDR", "it is left out of its pool");
+							if (!sound)
+								continue;
+							resolved = true;
+							for (const auto part : { formValue(sound), static_cast<std::uint64_t>(std::bit_cast<std::uint32_t>(member.weight)) })
+								hash = (hash ^ part) * 0x100000001B3ull;
+						}
+						if (resolved)
+							record(conflictMap[task.form][std::string(Schema::GetFieldName(section, field.key))], config.filename, hash);
+						continue;
+					}
+
+					const FormIndex::Form* value = nullptr;
+					if (field.value != Pack::kNone) {
+						value = lookup(task.config, field.value, Schema::GetFieldRecord(section, field.key), "this entry may be incomplete");
+						if (!value)
+							continue;
+					}
+
+					if (section == Schema::Section::kRegions) {
+						// Whether the region already had the sound is unknown offline, a sound without flags or chance is taken as new
+						auto& fields = conflictMapRegions[task.form][value];
+						const bool created = !(field.presence & (Pack::Field::kFlags | Pack::Field::kChance));
+						if (created || (field.presence & Pack::Field::kFlags))
+							record(fields["Flags"], config.filename, (field.presence & Pack::Field::kFlags) ? field.flags : 0b1111);
+						if (created || (field.presence & Pack::Field::kChance))
+							record(fields["Chance"], config.filename, std::bit_cast<std::uint32_t>((field.presence & Pack::Field::kChance) ? field.chance : 0.05f));
+					} else if (section == Schema::Section::kWeathers && value) {
+						// Adding a weather sound writes its type, null clears a type like any other field
+						record(conflictMapRegions[task.form][value]["Type"], config.filename, field.key);
+					} else {
+						record(conflictMap[task.form][std::string(Schema::GetFieldName(section, field.key))], config.filename, formValue(value));
+					}
+				}
+			}
+		}
+
+		std::size_t conflicts = 0;
+		std::cout << "Conflict summary:\n";
+
+		const auto printFields = [&](const std::map<std::string, Writes>& a_fields, std::string_view a_indent) {
+			for (const auto& [field, writes] : a_fields) {
+				std::cout << a_indent << field << " ";
+				for (const auto& file : writes.files)
+					std::cout << " -> " << file;
+				std::cout << "\n";
+			}
+		};
+		// A field is a conflict when it is left with more than one write once identical overrides collapse, the same
+		// rule as DataStorage::PrintConflicts. A field written once is a change, not a conflict.
+		const auto isConflict = [](const auto& a_entry) { return a_entry.second.files.size() > 1; };
+
+		for (const auto& [region, soundMap] : conflictMapRegions) {
+			bool printed = false;
+			for (const auto& [sound, fields] : soundMap) {
+				std::map<std::string, Writes> conflicting;
+				std::ranges::copy_if(fields, std::inserter(conflicting, conflicting.end()), isConflict);
+				if (conflicting.empty())
+					continue;
+				if (!printed)
+					std::cout << "\n" << FormatForm(region) << "\n";
+				printed = true;
+				std::cout << "    " << FormatForm(sound) << "\n";
+				printFields(conflicting, "        ");
+				conflicts += conflicting.size();
+			}
+		}
+
+		for (const auto& [form, fields] : conflictMap) {
+			std::map<std::string, Writes> conflicting;
+			std::ranges::copy_if(fields, std::inserter(conflicting, conflicting.end()), isConflict);
+			if (conflicting.empty())
+				continue;
+			std::cout << "\n" << FormatForm(form) << "\n";
+			printFields(conflicting, "    ");
+			conflicts += conflicting.size();
+		}
+
+		if (!conflicts)
+			std::cout << "No conflicts found.\n";
+
+		std::cout << "\nUnresolved forms:\n";
+		for (const auto& entry : unresolved)
+			std::cout << "    " << entry << "\n";
+		if (unresolved.empty())
+			std::cout << "    None\n";
+
+		const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - begin).count();
+		std::cout << "\n" << plugins.size() << " plugins, " << index.GetSize() << " forms, " << loader.configs.size() << " configs, "
+				  << records << " records, " << rules << " rules not evaluated, " << descriptors << " sound descriptors, " << replacements << " sound replacements, " << conflicts << " conflicting fields, " << collapsed << " identical overrides, " << unresolved.size() << " unresolved forms in " << ms << " ms\n";
+		return 0;
+	}
+
+	int EditorIDs(std::span<const std::string_view> a_args)
+	{
+		std::filesystem::path cache;
+		std::vector<std::string_view> lookups;
+		for (std::size_t i = 2; i < a_args.size(); i++) {
+			if (a_args[i] == "--cache" && i + 1 < a_args.size())
+				cache = a_args[++i];
+			else
+				lookups.push_back(a_args[i]);
+		}
+
+		const auto plugins = ReadPluginList(a_args[1]);
+
+		using clock = std::chrono::steady_clock;
+		const auto begin = clock::now();
+		EditorIDIndex index;
+		std::vector<std::string> errors;
+		index.Build(a_args[0], plugins, EditorIDIndex::GetSignatures(), cache, errors);
+		const auto ms = std::chrono::duration<double, std::milli>(clock::now() - begin).count();
+
+		for (const auto& error : errors)
+			std::cerr << error << "\n";
+
+		const auto& stats = index.GetStats();
+		std::cout << stats.editorIDs << " EditorIDs from " << stats.plugins << " plugins (" << stats.cachedPlugins << " cached) in " << ms << " ms\n";
+
+		int result = 0;
+		for (const auto editorID : lookups) {
+			if (const auto entry = index.Find(editorID)) {
+				std::cout << "  " << editorID << " -> " << PluginFile::FormatSignature(entry->signature) << " " << std::hex << std::uppercase << entry->localID << std::dec << "|" << entry->plugin << "\n";
+			} else {
+				std::cout << "  " << editorID << " -> not found\n";
+				result = 1;
+			}
+		}
+		return result;
+	}
+
+	int BenchPools(std::span<const std::string_view> a_args)
+	{
+		const auto parse = [&](std::size_t a_index, std::size_t a_default) {
+			return a_index < a_args.size() ? std::stoull(std::string(a_args[a_index])) : a_default;
+		};
+		const auto members = parse(0, 8);
+		const auto selections = parse(1, 100'000'000);
+		if (!members || members > 0xFFFFFFFF) {
+			std::cerr << "A pool needs between 1 and 2^32 - 1 members\n";
+			return 1;
+		}
+
+		// Weights 1, 2, 3... so every member has a different probability
+		std::vector<float> weights(members);
+		for (std::size_t i = 0; i < members; i++)
+			weights[i] = static_cast<float>(i + 1);
+
+		using clock = std::chrono::steady_clock;
+		auto begin = clock::now();
+		const AliasTable table(weights);
+		const auto buildUs = std::chrono::duration<double, std::micro>(clock::now() - begin).count();
+
+		std::vector<std::uint64_t> counts(members);
+		std::uint64_t state = 0x5244524442454E43ull;
+		begin = clock::now();
+		for (std::size_t i = 0; i < selections; i++)
+			counts[table.Sample(AliasTable::NextRandom(state))]++;
+		const auto seconds = std::chrono::duration<double>(clock::now() - begin).count();
+
+		// Worst member, in standard deviations of a binomial draw
+		double worst = 0.0;
+		for (std::uint32_t i = 0; i < members; i++) {
+			const auto expected = table.GetProbability(i) * static_cast<double>(selections);
+			const auto deviation = std::sqrt(std::max(expected * (1.0 - table.GetProbability(i)), 1.0));
+			worst = std::max(worst, std::abs(static_cast<double>(counts[i]) - expected) / deviation);
+		}
+
+		const auto total = std::accumulate(weights.begin(), weights.end(), 0.0);
+		double tableError = 0.0;
+		for (std::uint32_t i = 0; i < members; i++)
+			tableError = std::max(tableError, std::abs(table.GetProbability(i) - weights[i] / total));
+
+		std::cout << members << " members, built in " << buildUs << " us\n"
+				  << selections << " selections in " << seconds * 1000.0 << " ms, "
+				  << (seconds > 0.0 ? static_cast<double>(selections) / seconds / 1e6 : 0.0) << " M selections/s\n"
+				  << "Largest table error " << tableError << ", largest drawn deviation " << worst << " sigma\n";
+		return worst < 6.0 && tableError < 1e-6 ? 0 : 1;
+	}
+}
+
+int main(int a_argc, char** a_argv)
+{
+	const std::vector<std::string_view> args(a_argv + 1, a_argv + a_argc);
+
+	try {
+		if (args.size() == 3 && args[0] == "compile")
+			return Compile(args[1], args[2]);
+		if (args.size() == 2 && args[0] == "info")
+			return Info(args[1]);
+		if (args.size() >= 3 && args[0] == "conflicts")
+			return Conflicts(std::span{ args }.subspan(1));
+		if (args.size() >= 3 && args[0] == "editorids")
+			return EditorIDs(std::span{ args }.subspan(1));
+		if (!args.empty() && args.size() <= 3 && args[0] == "bench-pools")
+			return BenchPools(std::span{ args }.subspan(1));
+	} catch (const std::exception& exc) {
+		std::cerr << exc.what() << "\n";
+		return 1;
+	}
+
+	PrintUsage();
+	return 2;
+}
@@ -0,0 +1,203 @@
+#include "AliasTable.h"
+#include "Check.h"
+#include "ConfigPack.h"
+
+// Applying a record whose forms are already resolved must not touch the heap. The apply functions themselves need the
+// game, so this walks compiled packs the way they do: values from the resolved table, region flags and chance, pool
+// proxies and draws, and conflict entries into the buffer the shard reserved. Every allocation in between fails the test.
+
+namespace
+{
+	thread_local bool counting = false;
+	std::atomic<std::size_t> allocations = 0;
+
+	// Same layout as DataStorage::ApplyBuffer::Conflict
+	struct Conflict
+	{
+		const void* form;
+		const void* sound;
+		std::string_view field;
+		std::uint32_t config;
+		std::uint64_t value;
+	};
+
+	// What ResolveIdentifiers and CreateSoundPools leave behind for one pack
+	struct Resolved
+	{
+		std::vector<const void*> forms;
+		std::vector<const void*> pools;
+		std::vector<AliasTable> tables;
+		std::vector<int> storage;  // stands in for the forms
+	};
+
+	Resolved Resolve(const Pack::View& a_pack)
+	{
+		Resolved result;
+		result.storage.resize(a_pack.identifiers.size() + a_pack.pools.size());
+		for (std::size_t i = 0; i < a_pack.identifiers.size(); i++) {
+			// EditorIDs that start with "Missing" don't resolve
+			const auto& identifier = a_pack.identifiers[i];
+			const bool missing = identifier.IsEditorID() && a_pack.GetString(identifier.value).starts_with("Missing");
+			result.forms.push_back(missing ? nullptr : &result.storage[i]);
+		}
+		for (std::size_t i = 0; i < a_pack.pools.size(); i++) {
+			std::vector<float> weights;
+			for (const auto& member : a_pack.GetMembers(a_pack.pools[i]))
+				weights.push_back(member.weight);
+			result.tables.emplace_back(weights);
+			result.pools.push_back(&result.storage[a_pack.identifiers.size() + i]);
+		}
+		return result;
+	}
+
+	std::uint32_t GetID(const Resolved& a_resolved, const void* a_form)
+	{
+		return a_form ? static_cast<std::uint32_t>(static_cast<const int*>(a_form) - a_resolved.storage.data()) + 1 : 0;
+	}
+
+	// Mirrors the apply step of one shard, returns the number of allocations it made
+	std::size_t Apply(const Pack::View& a_pack, const Resolved& a_resolved, std::span<const void* const> a_ruleMatches, std::vector<Conflict>& a_conflicts)
+	{
+		std::uint64_t random = 1;
+
+		const auto before = allocations.load();
+		counting = true;
+		for (std::uint32_t c = 0; c < a_pack.configs.size(); c++) {
+			for (const auto& record : a_pack.GetRecords(a_pack.configs[c])) {
+				const auto forms = record.target == Pack::Record::Target::kRule ? a_ruleMatches : std::span(&a_resolved.forms[record.form], 1);
+				for (const auto form : forms) {
+					if (!form)
+						continue;
+					for (const auto& field : a_pack.GetFields(record)) {
+						const bool pool = field.presence & Pack::Field::kPool;
+						const void* value = nullptr;
+						if (field.value != Pack::kNone) {
+							value = pool ? a_resolved.pools[field.value] : a_resolved.forms[field.value];
+							if (!value)
+								continue;  // the error path formats a message, it is allowed to allocate
+						}
+						if (pool)
+							CHECK(a_resolved.tables[field.value].Sample(AliasTable::NextRandom(random)) < a_resolved.tables[field.value].GetSize());
+
+						if (record.section == Schema::Section::kRegions) {
+							// A sound without flags or chance is taken as new, it gets both defaults
+							const bool created = !(field.presence & (Pack::Field::kFlags | Pack::Field::kChance));
+							if (created || (field.presence & Pack::Field::kFlags))
+								a_conflicts.push_back({ form, value, "Flags"sv, c, (field.presence & Pack::Field::kFlags) ? field.flags : 0b1111u });
+							if (created || (field.presence & Pack::Field::kChance))
+								a_conflicts.push_back({ form, value, "Chance"sv, c, std::bit_cast<std::uint32_t>((field.presence & Pack::Field::kChance) ? field.chance : 0.05f) });
+						} else {
+							a_conflicts.push_back({ form, nullptr, Schema::GetFieldName(record.section, field.key), c, GetID(a_resolved, value) });
+						}
+					}
+				}
+			}
+		}
+		counting = false;
+		return allocations.load() - before;
+	}
+
+	// What DataStorage::ReserveConflicts reserves for a shard holding every record, a rule record once per match
+	std::size_t GetReserve(const Pack::View& a_pack, std::size_t a_ruleMatches)
+	{
+		std::size_t result = 0;
+		for (const auto& record : a_pack.records)
+			result += record.GetMaxConflicts() * (record.IsRule() ? a_ruleMatches : 1);
+		return result;
+	}
+
+	constexpr auto config = R"({
+		"Regions": [
+			{ "Form": "Skyrim.esm|0x1000", "RDSA": [
+				{ "Sound": "AMBWind", "Flags": "Pleasant Cloudy", "Chance": 0.25 },
+				{ "Sound": "AMBCave" },
+				{ "Sound": "MissingSound", "Chance": 0.5 }
+			] }
+		],
+		"Weapons": [
+			{ "Form": "IronSword", "Attack": "WPNSwing", "Idle": null, "Equip": [ "WPNEquip01", { "Sound": "WPNEquip02", "Weight": 3 } ] },
+			{ "Form": "MissingSword", "Attack": "WPNSwing" }
+		],
+		"Doors": [
+			{ "Rule": { "Keywords": [ "Skyrim.esm|0xABC" ], "Plugins": "Skyrim.esm" }, "Open": "DRSOpen", "Close": "Skyrim.esm|0x2000" }
+		],
+		"Weathers": [
+			{ "Form": "SkyrimStorm", "Wind": "AMBWind", "Thunder": null }
+		]
+	})";
+}
+
+namespace
+{
+	void* Allocate(std::size_t a_size, std::align_val_t a_alignment = std::align_val_t{ __STDCPP_DEFAULT_NEW_ALIGNMENT__ })
+	{
+		if (counting)
+			allocations++;
+		// aligned_alloc wants a multiple of the alignment
+		const auto alignment = static_cast<std::size_t>(a_alignment);
+		const auto size = (std::max<std::size_t>(a_size, 1) + alignment - 1) / alignment * alignment;
+		if (const auto memory = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? std::aligned_alloc(alignment, size) : std::malloc(size))
+			return memory;
+		throw std::bad_alloc();
+	}
+}
+
+// Every replaceable form, so no allocation falls back to the library and GCC never pairs its new with our free
+void* operator new(std::size_t a_size) { return Allocate(a_size); }
+void* operator new[](std::size_t a_size) { return Allocate(a_size); }
+void* operator new(std::size_t a_size, std::align_val_t a_alignment) { return Allocate(a_size, a_alignment); }
+void* operator new[](std::size_t a_size, std::align_val_t a_alignment) { return Allocate(a_size, a_alignment); }
+
+void operator delete(void* a_memory) noexcept { std::free(a_memory); }
+void operator delete[](void* a_memory) noexcept { std::free(a_memory); }
+void operator delete(void* a_memory, std::size_t) noexcept { std::free(a_memory); }
+void operator delete[](void* a_memory, std::size_t) noexcept { std::free(a_memory); }
+void operator delete(void* a_memory, std::align_val_t) noexcept { std::free(a_memory); }
+void operator delete[](void* a_memory, std::align_val_t) noexcept { std::free(a_memory); }
+void operator delete(void* a_memory, std::size_t, std::align_val_t) noexcept { std::free(a_memory); }
+void operator delete[](void* a_memory, std::size_t, std::align_val_t) noexcept { std::free(a_memory); }
+
+int main()
+{
+	// The counter has to see an allocation for a zero to mean anything
+	counting = true;
+	std::vector<int> probe(16);
+	counting = false;
+	CHECK(allocations.load() > 0 && !probe.empty());
+
+	Pack::Builder builder;
+	std::vector<std::string> errors;
+	builder.AddConfig("Test_SRD", nlohmann::json::parse(config), errors);
+	CHECK(errors.empty());
+
+	const auto check = [&](const Pack::View& a_pack) {
+		const auto resolved = Resolve(a_pack);
+		int matches[3]{};
+		const void* const ruleMatches[] = { &matches[0], &matches[1], &matches[2] };
+
+		std::vector<Conflict> conflicts;
+		conflicts.reserve(GetReserve(a_pack, std::size(ruleMatches)));
+		const auto capacity = conflicts.capacity();
+
+		CHECK(Apply(a_pack, resolved, ruleMatches, conflicts) == 0);
+		CHECK(conflicts.capacity() == capacity);
+		// Region: flags and chance of two sounds, the missing one is skipped. Weapon: three fields, the missing weapon
+		// is skipped. Doors: two fields on three matches. Weather: two fields.
+		CHECK(conflicts.size() == 4 + 3 + 6 + 2);
+	};
+
+	check(builder.GetView());
+
+	const auto path = std::filesystem::temp_directory_path() / "ApplyAllocationTest_SRD.srdb";
+	CHECK(builder.Write(path));
+	{
+		Pack::Bundle bundle;
+		std::string error;
+		CHECK(bundle.Open(path, error));
+		if (error.empty())
+			check(bundle.GetView());
+	}
+	std::filesystem::remove(path);
+
+	return Test::Result();
+}
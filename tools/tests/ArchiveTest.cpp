@@ -0,0 +1,244 @@
+#include "Archive.h"
+#include "Check.h"
+#include "ConfigLoader.h"
+
+#include <lz4frame.h>
+#include <zlib.h>
+
+// Reads synthetic BSAs written here: version 104 with zlib and 105 with LZ4, embedded names, the per-file compression
+// toggle, loose configs overriding archived ones, and archives whose header or records are cut short or corrupt.
+
+namespace
+{
+	struct File
+	{
+		std::string folder;  // "." for the archive root
+		std::string name;
+		std::string content;
+		bool toggle = false;  // flips the archive's compression for this file
+	};
+
+	enum Flag : std::uint32_t
+	{
+		kDirectoryNames = 0x1,
+		kFileNames = 0x2,
+		kCompressed = 0x4,
+		kEmbeddedNames = 0x100
+	};
+
+	template <class T>
+	void Append(std::string& a_out, T a_value)
+	{
+		a_out.append(reinterpret_cast<const char*>(&a_value), sizeof(T));
+	}
+
+	std::string Compress(std::uint32_t a_version, const std::string& a_content)
+	{
+		std::string result;
+		if (a_version == 105) {
+			result.resize(LZ4F_compressFrameBound(a_content.size(), nullptr));
+			result.resize(LZ4F_compressFrame(result.data(), result.size(), a_content.data(), a_content.size(), nullptr));
+		} else {
+			uLongf size = compressBound(static_cast<uLong>(a_content.size()));
+			result.resize(size);
+			compress(reinterpret_cast<Bytef*>(result.data()), &size, reinterpret_cast<const Bytef*>(a_content.data()), static_cast<uLong>(a_content.size()));
+			result.resize(size);
+		}
+		return result;
+	}
+
+	// Folders are written in the order their first file appears, files keep their order within a folder
+	std::string BuildArchive(std::uint32_t a_version, std::uint32_t a_flags, const std::vector<File>& a_files)
+	{
+		std::vector<std::pair<std::string, std::vector<const File*>>> folders;
+		for (const auto& file : a_files) {
+			auto it = std::ranges::find(folders, file.folder, &std::pair<std::string, std::vector<const File*>>::first);
+			if (it == folders.end())
+				it = folders.insert(folders.end(), { file.folder, {} });
+			it->second.push_back(&file);
+		}
+
+		std::uint32_t folderNamesLength = 0;
+		std::uint32_t fileNamesLength = 0;
+		for (const auto& [folder, files] : folders) {
+			folderNamesLength += static_cast<std::uint32_t>(folder.size() + 1);
+			for (const auto file : files)
+				fileNamesLength += static_cast<std::uint32_t>(file->name.size() + 1);
+		}
+
+		const std::size_t folderRecordSize = a_version == 105 ? 24 : 16;
+		const std::size_t dataOffset = 36 + folders.size() * folderRecordSize + folders.size() + folderNamesLength + a_files.size() * 16 + fileNamesLength;
+
+		std::string blocks;
+		std::string records;
+		std::string names;
+		for (const auto& [folder, files] : folders) {
+			Append<std::uint8_t>(records, static_cast<std::uint8_t>(folder.size() + 1));
+			records += folder;
+			records += '\0';
+			for (const auto file : files) {
+				std::string block;
+				if (a_flags & kEmbeddedNames) {
+					const auto path = folder == "." ? file->name : folder + '\\' + file->name;
+					Append<std::uint8_t>(block, static_cast<std::uint8_t>(path.size()));
+					block += path;
+				}
+				if (static_cast<bool>(a_flags & kCompressed) != file->toggle) {
+					Append<std::uint32_t>(block, static_cast<std::uint32_t>(file->content.size()));
+					block += Compress(a_version, file->content);
+				} else {
+					block += file->content;
+				}
+
+				Append<std::uint64_t>(records, 0);
+				Append<std::uint32_t>(records, static_cast<std::uint32_t>(block.size()) | (file->toggle ? 0x40000000 : 0));
+				Append<std::uint32_t>(records, static_cast<std::uint32_t>(dataOffset + blocks.size()));
+				blocks += block;
+				names += file->name;
+				names += '\0';
+			}
+		}
+
+		std::string result;
+		for (const auto value : { 0x00415342u, a_version, 36u, a_flags | kDirectoryNames | kFileNames, static_cast<std::uint32_t>(folders.size()),
+				 static_cast<std::uint32_t>(a_files.size()), folderNamesLength, fileNamesLength, 0u })
+			Append(result, value);
+		for (const auto& [folder, files] : folders) {
+			Append<std::uint64_t>(result, 0);
+			Append<std::uint32_t>(result, static_cast<std::uint32_t>(files.size()));
+			if (a_version == 105) {
+				Append<std::uint32_t>(result, 0);
+				Append<std::uint64_t>(result, 0);
+			} else {
+				Append<std::uint32_t>(result, 0);
+			}
+		}
+		result += records;
+		result += names;
+		result += blocks;
+		CHECK(result.size() == dataOffset + blocks.size());
+		return result;
+	}
+
+	void WriteFile(const std::filesystem::path& a_path, std::string_view a_data)
+	{
+		std::ofstream stream(a_path, std::ios::binary | std::ios::trunc);
+		stream.write(a_data.data(), static_cast<std::streamsize>(a_data.size()));
+	}
+
+	// Opens a_data as an archive and reads every entry, fails on the first problem
+	std::map<std::string, std::string> ReadAll(const std::filesystem::path& a_path, std::string_view a_data, std::string& a_error)
+	{
+		WriteFile(a_path, a_data);
+		Archive archive;
+		if (!archive.Open(a_path, a_error))
+			return {};
+		const auto entries = archive.GetEntries();
+		if (entries.empty()) {
+			a_error = archive.GetError();
+			return {};
+		}
+		std::map<std::string, std::string> result;
+		for (const auto& entry : entries) {
+			std::string data;
+			if (!archive.Read(entry, data, a_error))
+				return {};
+			result[std::string(entry.folder) + '\\' + std::string(entry.name)] = std::move(data);
+		}
+		return result;
+	}
+
+	const std::string repeated(4000, 'a');
+
+	const std::vector<File> files = {
+		{ ".", "Test_SRD.yaml", "Doors:\n  - Form: DoorWood\n    Open: DRSOpen\n" },
+		{ ".", "Plain_SRD.yaml", "# " + repeated + "\nDoors:\n  - Form: DoorArchived\n    Open: DRSOpen\n", true },
+		{ "sound\\fx", "wind.wav", std::string("RIFF\0\0\0\0WAVE", 12) + repeated }
+	};
+
+	void CheckContents(const std::map<std::string, std::string>& a_contents)
+	{
+		CHECK(a_contents.size() == 3);
+		for (const auto& file : files) {
+			const auto it = a_contents.find(file.folder + '\\' + file.name);
+			CHECK(it != a_contents.end() && it->second == file.content);
+		}
+	}
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path() / "ArchiveTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	const auto path = directory / "Test.bsa";
+	std::string error;
+
+	// Compressed by default with one file stored, and the other way around, with and without embedded names
+	for (const auto version : { 104u, 105u }) {
+		for (const auto flags : { std::uint32_t{ kCompressed }, std::uint32_t{ 0 }, kCompressed | kEmbeddedNames, std::uint32_t{ kEmbeddedNames } }) {
+			error.clear();
+			CheckContents(ReadAll(path, BuildArchive(version, flags, files), error));
+			CHECK(error.empty());
+		}
+	}
+
+	// Truncated or corrupt headers and records are reported, never read past the end or allocated for
+	const auto valid = BuildArchive(105, kCompressed, files);
+	const auto corrupt = [&](std::size_t a_offset, std::uint32_t a_value) {
+		auto data = valid;
+		std::memcpy(data.data() + a_offset, &a_value, sizeof(a_value));
+		return data;
+	};
+	const std::pair<std::string_view, std::string> damaged[] = {
+		{ "empty file", "" },
+		{ "header cut short", valid.substr(0, 20) },
+		{ "wrong magic", corrupt(0, 0x12345678) },
+		{ "unsupported version", corrupt(4, 103) },
+		{ "records offset inside the header", corrupt(8, 8) },
+		{ "records offset past the end", corrupt(8, 0xFFFFFFF0) },
+		{ "folder count past the end", corrupt(16, 0xFFFFFFFF) },
+		{ "file count past the end", corrupt(20, 0xFFFFFFFF) },
+		{ "file names cut short", corrupt(28, 0xFFFF) },
+		{ "records cut short", valid.substr(0, 36 + 2 * 24 + 5) },
+		{ "data cut short", valid.substr(0, valid.size() - 100) },
+		{ "compressed data corrupt", valid.substr(0, valid.size() - 40) + std::string(40, '\x7F') }
+	};
+	for (const auto& [what, data] : damaged) {
+		error.clear();
+		const auto contents = ReadAll(path, data, error);
+		if (error.empty())
+			std::cerr << what << ": no error\n";
+		CHECK(!error.empty());
+	}
+
+	// A loose config overrides the archived one of the same name, the other archived configs are still read
+	{
+		const auto data = directory / "Data";
+		std::filesystem::create_directories(data);
+		WriteFile(data / "Test_SRD.yaml", "Doors:\n  - Form: DoorLoose\n    Open: DRSOpen\n");
+		const auto archive = data / "Test.bsa";
+		WriteFile(archive, BuildArchive(104, kCompressed, files));
+
+		std::vector<std::string> messages;
+		ConfigLoader loader([](std::string_view) { return true; }, [&](ConfigLoader::Level, const std::string& a_message) { messages.push_back(a_message); });
+		const std::filesystem::path archives[] = { archive };
+		const auto [generalConfigs, pluginConfigs] = loader.ScanConfigDirectory(data, archives);
+		CHECK(generalConfigs.size() == 2);
+		CHECK(generalConfigs.contains((data / "Test_SRD.yaml").string()));
+		CHECK(generalConfigs.contains((archive / "Plain_SRD.yaml").string()));
+
+		loader.ParseAllConfigs({}, generalConfigs);
+		std::set<std::string> forms;
+		for (const auto& config : loader.configs) {
+			const auto& pack = *config.pack;
+			for (const auto& record : pack.GetRecords(pack.configs[config.index]))
+				forms.insert(pack.FormatIdentifier(record.form));
+		}
+		CHECK(loader.configs.size() == 2);
+		CHECK(forms == std::set<std::string>{ "DoorArchived", "DoorLoose" });
+	}
+
+	std::filesystem::remove_all(directory);
+	return Test::Result();
+}
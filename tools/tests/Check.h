@@ -0,0 +1,27 @@
+#pragma once
+
+#include <source_location>
+
+// Just enough to write the tests without a framework: a failed CHECK prints where it failed and the test returns
+// non-zero from main through Test::Result
+namespace Test
+{
+	inline int failures = 0;
+
+	inline void Check(bool a_condition, std::string_view a_expression, std::source_location a_location = std::source_location::current())
+	{
+		if (a_condition)
+			return;
+		failures++;
+		std::cerr << a_location.file_name() << ":" << a_location.line() << ": CHECK(" << a_expression << ") failed\n";
+	}
+
+	inline int Result()
+	{
+		if (failures)
+			std::cerr << failures << " checks failed\n";
+		return failures ? 1 : 0;
+	}
+}
+
+#define CHECK(...) Test::Check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__)
@@ -0,0 +1,269 @@
+#include "Check.h"
+#include "EditorIDIndex.h"
+#include "PluginFile.h"
+
+#include <zlib.h>
+
+// Reads synthetic plugins written here: a master, a plugin and a light plugin with compressed records, subrecords
+// larger than 64 KiB behind XXXX, interior cells in their blocks, and form IDs owned by masters. Then the EditorID
+// index over them, read from the plugins, from its cache, and from caches that are cut short or corrupt.
+
+namespace
+{
+	template <class T>
+	void Append(std::string& a_out, T a_value)
+	{
+		a_out.append(reinterpret_cast<const char*>(&a_value), sizeof(T));
+	}
+
+	void AppendSignature(std::string& a_out, std::string_view a_signature)
+	{
+		Append(a_out, PluginFile::MakeSignature(a_signature));
+	}
+
+	// A subrecord too large for its 16-bit size is preceded by XXXX with the real size
+	std::string Subrecord(std::string_view a_signature, std::string_view a_data)
+	{
+		std::string result;
+		if (a_data.size() > 0xFFFF) {
+			AppendSignature(result, "XXXX");
+			Append<std::uint16_t>(result, 4);
+			Append<std::uint32_t>(result, static_cast<std::uint32_t>(a_data.size()));
+		}
+		AppendSignature(result, a_signature);
+		Append<std::uint16_t>(result, static_cast<std::uint16_t>(a_data.size() > 0xFFFF ? 0 : a_data.size()));
+		result += a_data;
+		return result;
+	}
+
+	std::string EditorID(std::string_view a_editorID)
+	{
+		return Subrecord("EDID", std::string(a_editorID) + '\0');
+	}
+
+	std::string Record(std::string_view a_signature, std::uint32_t a_formID, const std::string& a_subrecords, bool a_compressed = false)
+	{
+		std::string data = a_subrecords;
+		if (a_compressed) {
+			uLongf size = compressBound(static_cast<uLong>(a_subrecords.size()));
+			std::string compressed(size, '\0');
+			compress(reinterpret_cast<Bytef*>(compressed.data()), &size, reinterpret_cast<const Bytef*>(a_subrecords.data()), static_cast<uLong>(a_subrecords.size()));
+			compressed.resize(size);
+			data.clear();
+			Append<std::uint32_t>(data, static_cast<std::uint32_t>(a_subrecords.size()));
+			data += compressed;
+		}
+
+		std::string result;
+		AppendSignature(result, a_signature);
+		Append<std::uint32_t>(result, static_cast<std::uint32_t>(data.size()));
+		Append<std::uint32_t>(result, a_compressed ? std::uint32_t{ PluginFile::kCompressed } : std::uint32_t{ 0 });
+		Append<std::uint32_t>(result, a_formID);
+		Append<std::uint64_t>(result, 0);
+		return result + data;
+	}
+
+	// a_label is the record type of top level groups, a_type 0 for them, 2 and 3 for interior cell blocks
+	std::string Group(std::uint32_t a_label, std::uint32_t a_type, const std::string& a_content)
+	{
+		std::string result;
+		AppendSignature(result, "GRUP");
+		Append<std::uint32_t>(result, static_cast<std::uint32_t>(24 + a_content.size()));
+		Append<std::uint32_t>(result, a_label);
+		Append<std::uint32_t>(result, a_type);
+		Append<std::uint64_t>(result, 0);
+		return result + a_content;
+	}
+
+	std::string TopGroup(std::string_view a_signature, const std::string& a_content)
+	{
+		return Group(PluginFile::MakeSignature(a_signature), 0, a_content);
+	}
+
+	std::string Plugin(std::uint32_t a_flags, std::initializer_list<std::string_view> a_masters, const std::string& a_groups)
+	{
+		std::string header = Subrecord("HEDR", std::string(12, '\0'));
+		for (const auto master : a_masters)
+			header += Subrecord("MAST", std::string(master) + '\0') + Subrecord("DATA", std::string(8, '\0'));
+
+		std::string result;
+		AppendSignature(result, "TES4");
+		Append<std::uint32_t>(result, static_cast<std::uint32_t>(header.size()));
+		Append<std::uint32_t>(result, a_flags);
+		Append<std::uint32_t>(result, 0);
+		Append<std::uint64_t>(result, 0);
+		return result + header + a_groups;
+	}
+
+	void WriteFile(const std::filesystem::path& a_path, std::string_view a_data)
+	{
+		std::ofstream stream(a_path, std::ios::binary | std::ios::trunc);
+		stream.write(a_data.data(), static_cast<std::streamsize>(a_data.size()));
+	}
+
+	std::string ReadFile(const std::filesystem::path& a_path)
+	{
+		std::ifstream stream(a_path, std::ios::binary);
+		return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+	}
+
+	// Weapons, one compressed and one behind a subrecord only XXXX can size, an interior cell two blocks deep with a
+	// placed reference in its children, and an NPC in a group that is never read
+	const std::string master = Plugin(PluginFile::kMaster, {},
+		TopGroup("NPC_", Record("NPC_", 0x700, EditorID("NotIndexed"))) +
+			TopGroup("WEAP", Record("WEAP", 0x800, EditorID("IronSword")) +
+								 Record("WEAP", 0x801, EditorID("SteelSword") + Subrecord("DATA", std::string(100, 'x')), true) +
+								 Record("WEAP", 0x802, Subrecord("MODL", std::string(70000, 'm')) + EditorID("GiantSword")) +
+								 Record("WEAP", 0x803, Subrecord("DATA", std::string(4, '\0')))) +
+			TopGroup("CELL", Group(0, 2, Group(0, 3, Record("CELL", 0x900, EditorID("InteriorCell")) + Group(0x900, 6, Record("REFR", 0x901, EditorID("PlacedRef")))))));
+
+	// Overrides a master weapon under its own EditorID and defines new ones, one taking over a master's EditorID
+	const std::string patch = Plugin(0, { "Master.esm" },
+		TopGroup("WEAP", Record("WEAP", 0x00000800, EditorID("IronSword")) +
+							 Record("WEAP", 0x01000801, EditorID("PatchSword"), true) +
+							 Record("WEAP", 0x01000900, EditorID("SteelSword"))));
+
+	// A door of its own, an override of a weapon of the plugin before it, and a form ID past its masters
+	const std::string light = Plugin(PluginFile::kMaster | PluginFile::kLight, { "Master.esm", "Patch.esp" },
+		TopGroup("DOOR", Record("DOOR", 0x02000801, EditorID("LightDoor")) + Record("DOOR", 0x05000802, EditorID("StrayDoor"))) +
+			TopGroup("WEAP", Record("WEAP", 0x01000801, EditorID("PatchSwordRenamed"))));
+
+	struct Expected
+	{
+		std::string_view editorID;
+		std::string_view plugin;
+		std::uint32_t localID;
+		std::string_view signature;
+	};
+
+	constexpr Expected expected[] = {
+		{ "IronSword", "Master.esm", 0x800, "WEAP" },
+		{ "SteelSword", "Patch.esp", 0x900, "WEAP" },
+		{ "GiantSword", "Master.esm", 0x802, "WEAP" },
+		{ "InteriorCell", "Master.esm", 0x900, "CELL" },
+		{ "PatchSword", "Patch.esp", 0x801, "WEAP" },
+		{ "PatchSwordRenamed", "Patch.esp", 0x801, "WEAP" },
+		{ "LightDoor", "Light.esl", 0x801, "DOOR" },
+		{ "StrayDoor", "Light.esl", 0x802, "DOOR" }
+	};
+
+	const std::string plugins[] = { "Master.esm", "Patch.esp", "Missing.esp", "Light.esl" };
+
+	// Builds an index over the plugins and checks every EditorID, returns how many plugins came from the cache
+	std::size_t CheckIndex(const std::filesystem::path& a_directory, const std::filesystem::path& a_cache)
+	{
+		EditorIDIndex index;
+		std::vector<std::string> errors;
+		index.Build(a_directory, plugins, EditorIDIndex::GetSignatures(), a_cache, errors);
+		CHECK(errors.empty());
+		CHECK(index.GetStats().plugins == 3);
+		CHECK(index.GetStats().editorIDs == std::size(expected));
+		for (const auto& [editorID, plugin, localID, signature] : expected) {
+			const auto entry = index.Find(editorID);
+			CHECK(entry && entry->plugin == plugin && entry->localID == localID && entry->signature == PluginFile::MakeSignature(signature));
+			if (!entry || entry->plugin != plugin)
+				std::cerr << editorID << ": " << (entry ? entry->plugin : "not found"sv) << '\n';
+		}
+		CHECK(index.Find("ironsword") == index.Find("IRONSWORD") && index.Find("ironsword"));
+		CHECK(!index.Find("NotIndexed") && !index.Find("PlacedRef"));
+		return index.GetStats().cachedPlugins;
+	}
+}
+
+int main()
+{
+	const auto directory = std::filesystem::temp_directory_path() / "EditorIDIndexTest";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	WriteFile(directory / "Master.esm", master);
+	WriteFile(directory / "Patch.esp", patch);
+	WriteFile(directory / "Light.esl", light);
+	std::string error;
+
+	// The plugin files themselves
+	{
+		PluginFile file;
+		CHECK(file.Open(directory / "Light.esl", error));
+		CHECK(file.IsMaster() && file.IsLight());
+		CHECK(file.GetMasters() == std::vector<std::string>{ "Master.esm", "Patch.esp" });
+		CHECK(file.GetOwner(0x01000801) == std::pair<std::string_view, std::uint32_t>{ "Patch.esp", 0x801 });
+		CHECK(file.GetOwner(0x02000801) == std::pair<std::string_view, std::uint32_t>{ "Light.esl", 0x801 });
+
+		CHECK(file.Open(directory / "Master.esm", error));
+		CHECK(file.IsMaster() && !file.IsLight() && file.GetMasters().empty());
+
+		const std::uint32_t signatures[] = { PluginFile::MakeSignature("WEAP"), PluginFile::MakeSignature("CELL") };
+		std::vector<std::pair<std::uint32_t, std::string>> records;
+		std::size_t modelSize = 0;
+		CHECK(file.ForEachRecord(signatures, [&](const PluginFile::Record& a_record) {
+			records.emplace_back(a_record.formID, a_record.editorID);
+			for (const auto model : PluginFile::GetStrings(a_record.subrecords, PluginFile::MakeSignature("MODL")))
+				modelSize += model.size();
+		}, error));
+		CHECK(error.empty());
+		CHECK(modelSize == 70000);
+		CHECK(records == std::vector<std::pair<std::uint32_t, std::string>>{ { 0x800, "IronSword" }, { 0x801, "SteelSword" }, { 0x802, "GiantSword" }, { 0x803, "" }, { 0x900, "InteriorCell" } });
+	}
+
+	// Damaged plugins are reported, never read past their end
+	{
+		const auto path = directory / "Damaged.esp";
+		const auto damaged = [&](const std::string& a_data) {
+			WriteFile(path, a_data);
+			PluginFile file;
+			std::string damageError;
+			if (!file.Open(path, damageError))
+				return !damageError.empty();
+			const std::uint32_t signatures[] = { PluginFile::MakeSignature("WEAP") };
+			return !file.ForEachRecord(signatures, [](const PluginFile::Record&) {}, damageError) && !damageError.empty();
+		};
+		CHECK(damaged(""));
+		CHECK(damaged(patch.substr(0, 30)));
+		CHECK(damaged(patch.substr(0, patch.size() - 10)));
+		std::string compressedDamaged = Plugin(0, {}, TopGroup("WEAP", Record("WEAP", 0x800, EditorID("Sword") + std::string(200, 'z'), true)));
+		compressedDamaged.resize(compressedDamaged.size() - 20);
+		compressedDamaged += std::string(20, '\x7F');
+		CHECK(damaged(compressedDamaged));
+	}
+
+	// Read from the plugins, then from the cache, then again for the plugin that changed
+	const auto cache = directory / "EditorIDs.bin";
+	CHECK(CheckIndex(directory, cache) == 0);
+	CHECK(std::filesystem::exists(cache));
+	CHECK(CheckIndex(directory, cache) == 3);
+	WriteFile(directory / "Light.esl", light + TopGroup("ACTI", ""));
+	CHECK(CheckIndex(directory, cache) == 2);
+	CHECK(CheckIndex(directory, cache) == 3);
+
+	// A cache cut short or with counts past its end is no cache at all, and is written again
+	const auto valid = ReadFile(cache);
+	const auto corrupt = [&](std::size_t a_offset, std::uint32_t a_value) {
+		auto data = valid;
+		std::memcpy(data.data() + a_offset, &a_value, sizeof(a_value));
+		return data;
+	};
+	// Header, then the first plugin: its name, size and time, its owners and its records
+	constexpr std::size_t pluginCount = 12;
+	constexpr std::size_t ownerCount = 16 + 2 + "Master.esm"sv.size() + 16;
+	constexpr std::size_t recordCount = ownerCount + 4 + 2 + "Master.esm"sv.size();
+	const std::pair<std::string_view, std::string> damaged[] = {
+		{ "empty", "" },
+		{ "header cut short", valid.substr(0, 10) },
+		{ "records cut short", valid.substr(0, valid.size() - 3) },
+		{ "plugin count past the end", corrupt(pluginCount, 0xFFFFFFFF) },
+		{ "owner count past the end", corrupt(ownerCount, 0xFFFFFFFF) },
+		{ "record count past the end", corrupt(recordCount, 0xFFFFFFFF) },
+		{ "owner index past the owners", corrupt(recordCount + 4 + 8, 7) }
+	};
+	for (const auto& [what, data] : damaged) {
+		WriteFile(cache, data);
+		const auto cached = CheckIndex(directory, cache);
+		if (cached != 0)
+			std::cerr << what << ": " << cached << " plugins read from the cache\n";
+		CHECK(cached == 0);
+		CHECK(ReadFile(cache) == valid);
+	}
+
+	std::filesystem::remove_all(directory);
+	return Test::Result();
+}